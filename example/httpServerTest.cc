@@ -3,9 +3,6 @@
 #include "./http/HttpResponse.h"
 #include "./base/CommonConfig.h"
 #include "./log/Logging.h"
-#include <fcntl.h>       // open
-#include <sys/mman.h>    // mmap, munmap
-#include <sys/stat.h> 
 
 std::string getFileType(const HttpConfigInfo& httpConfig_ , const std::string &path_) {
     /* 判断文件类型 */
@@ -22,44 +19,12 @@ std::string getFileType(const HttpConfigInfo& httpConfig_ , const std::string &p
 
 bool addResponseBody(HttpResponse* response , const std::string &filePath)
 {
-    struct stat mmFileStat_ = {0} ;
-    bool file_exist = ::stat(filePath.data() , &mmFileStat_) == 0 ;
-    if(!file_exist || S_ISDIR(mmFileStat_.st_mode)) { 
+    // 文件内容由 TcpConnection::sendFile 通过 sendfile 直接从内核发送，不再 mmap 之后拷贝到 Buffer 中
+    if(!response->setBodyFile(filePath)) { 
         LOG_ERROR("file %s not exist!!!" , filePath.data());
         response->setBody("404") ; 
         return false ;   
     }
-
-    auto close_func = [](int* fd) {
-        if (fd) {
-            ::close(*fd);
-            delete fd ;
-            fd = nullptr ; 
-        }
-    };
-    std::unique_ptr<int , decltype(close_func) > fd(new int(open(filePath.data(), O_RDONLY)) , close_func);
-    if (*fd == -1) {
-        LOG_ERROR("open file %s error !!!" ,  filePath.data()); 
-        response->setBody("404") ; 
-        return false ;   
-    }
-    
-    auto munmap_func = [&mmFileStat_](char *data){
-        if(data != MAP_FAILED){
-            munmap(data , mmFileStat_.st_size) ; 
-        }
-    } ; 
-
-    std::shared_ptr<char> dataFile(
-            reinterpret_cast<char*>(mmap(nullptr, mmFileStat_.st_size, PROT_READ, MAP_PRIVATE , *fd , 0)), 
-            munmap_func
-        ) ; 
-    if(dataFile.get()  == MAP_FAILED) { 
-        LOG_ERROR("mmap file %s error %d !!!" ,  filePath.data() , errno);
-        response->setBody("404") ; 
-        return false ;   
-    }
-    response->setBody(dataFile , mmFileStat_.st_size) ;  
     return true ;
 }
 
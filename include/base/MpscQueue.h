@@ -0,0 +1,92 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <utility>
+#include <stddef.h>
+#include "noncopyable.h"
+
+/**
+ * 无锁的多生产者单消费者队列，用于 EventLoop 跨线程投递回调
+ * 生产者通过 CAS 把节点挂到链表头部(节点内嵌待执行的任务，每次 push 只有一次分配)
+ * 消费者通过一次 exchange 取走整条链表，再反转成先进先出的顺序执行
+ * 这样和原来 swap pendingFunctors_ 的语义一样：一次只处理取出时已经在队列中的任务
+ */
+template <typename T>
+class MpscQueue : noncopyable
+{
+public:
+    MpscQueue()
+        : head_(nullptr)
+    {
+    }
+
+    ~MpscQueue()
+    {
+        Node *node = head_.load();
+        while (node != nullptr)
+        {
+            Node *next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+
+    // 线程安全，可以在任意线程调用
+    void push(T value)
+    {
+        Node *node = new Node(std::move(value));
+        Node *oldHead = head_.load(std::memory_order_relaxed);
+        do
+        {
+            node->next = oldHead;
+        } while (!head_.compare_exchange_weak(oldHead, node));
+    }
+
+    bool empty() const { return head_.load() == nullptr; }
+
+    // 只能在消费者线程调用，按入队顺序对取出的每个任务执行 func ，返回执行的任务数量
+    template <typename Func>
+    size_t consumeAll(Func func)
+    {
+        Node *node = head_.exchange(nullptr);
+
+        // 链表头部是最后入队的任务，反转成入队顺序
+        Node *reversed = nullptr;
+        while (node != nullptr)
+        {
+            Node *next = node->next;
+            node->next = reversed;
+            reversed = node;
+            node = next;
+        }
+
+        size_t count = 0;
+        while (reversed != nullptr)
+        {
+            Node *next = reversed->next;
+            func(reversed->value);
+            delete reversed;
+            reversed = next;
+            ++count;
+        }
+        return count;
+    }
+
+private:
+    struct Node
+    {
+        explicit Node(T &&v)
+            : value(std::move(v)),
+              next(nullptr)
+        {
+        }
+
+        T value;
+        Node *next;
+    };
+
+    std::atomic<Node*> head_;   // 最后入队的节点
+};
+
+#endif // MPSC_QUEUE_H
@@ -0,0 +1,78 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+#include <stddef.h>
+#include "noncopyable.h"
+
+/**
+ * 固定大小内存块的分配器，每次向系统申请一批内存块，释放的块放入空闲链表重复使用
+ * 块大小由第一次分配决定，之后大小不同的请求直接使用 operator new
+ * 释放可能发生在其他线程(例如用户线程持有的最后一个 TcpConnectionPtr)，空闲链表用互斥锁保护，正常情况下没有竞争
+ * 申请过的内存在分配器析构之前不会归还给系统
+ */
+class FixedSizeSlab : noncopyable
+{
+public:
+    explicit FixedSizeSlab(size_t blocksPerChunk = 64);
+    ~FixedSizeSlab();
+
+    void* allocate(size_t size);
+    void deallocate(void *p, size_t size);
+
+    // 分配出去还没有释放的块数
+    size_t inUse() const;
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    const size_t blocksPerChunk_;
+    mutable std::mutex mutex_;
+    size_t blockSize_;          // 0 表示还没有确定
+    FreeBlock *freeList_;
+    size_t inUse_;
+    std::vector<char*> chunks_;
+};
+
+/**
+ * 从 FixedSizeSlab 分配的 STL 分配器，配合 std::allocate_shared 使用时对象和引用计数在同一个块中
+ * 分配器持有 slab 的 shared_ptr ，控制块中保存了一份，最后一个对象释放之后 slab 才会析构
+ */
+template <typename T>
+class SlabAllocator
+{
+public:
+    using value_type = T;
+
+    explicit SlabAllocator(const std::shared_ptr<FixedSizeSlab> &slab) : slab_(slab) { }
+    template <typename U>
+    SlabAllocator(const SlabAllocator<U> &other) : slab_(other.slab()) { }
+
+    T* allocate(size_t n)
+    {
+        return static_cast<T*>(slab_->allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n)
+    {
+        slab_->deallocate(p, n * sizeof(T));
+    }
+
+    const std::shared_ptr<FixedSizeSlab>& slab() const { return slab_; }
+
+private:
+    std::shared_ptr<FixedSizeSlab> slab_;
+};
+
+template <typename T, typename U>
+bool operator==(const SlabAllocator<T> &a, const SlabAllocator<U> &b) { return a.slab() == b.slab(); }
+template <typename T, typename U>
+bool operator!=(const SlabAllocator<T> &a, const SlabAllocator<U> &b) { return a.slab() != b.slab(); }
+
+#endif // SLAB_H
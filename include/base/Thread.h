@@ -6,6 +6,7 @@
 #include <functional>
 #include <atomic>
 #include <string>
+#include <vector>
 #include "noncopyable.h"
 
 class Thread : noncopyable
@@ -18,12 +19,20 @@ public :
     void start(); // 开启线程
     void join();  // 等待线程
 
+    // 把线程绑定到指定的 CPU 上，需要在 start 之前设置，-1 表示不绑定
+    // 绑定之后线程的内存分配优先使用该 CPU 所在的 NUMA 节点
+    void setCpuAffinity(int cpu) { cpu_ = cpu; }
+    int cpuAffinity() const { return cpu_; }
+
     bool started() const { return started_; }
     pid_t tid() const { return tid_; }
     const std::string& name() const { return name_; }
 
     static int numCreated() { return numCreated_; }
 
+    // 当前进程可用的 CPU 中每个物理核取一个逻辑 CPU ，跳过超线程的兄弟 CPU
+    static std::vector<int> physicalCoreCpus();
+
 private:
     void setDefaultName();  // 设置线程名
 
@@ -33,6 +42,7 @@ private:
     pid_t tid_;     // 线程tid 
     ThreadFunc func_;   
     std::string name_;  // 线程名
+    int cpu_;           // 绑定的 CPU ，-1 表示不绑定
     static std::atomic_int32_t numCreated_; // 线程索引
 } ; 
 
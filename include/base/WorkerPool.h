@@ -0,0 +1,75 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <stdint.h>
+#include "noncopyable.h"
+
+class Thread;
+
+/**
+ * 执行阻塞任务(数据库查询、签名、哈希等)的工作线程池，和 IO loop 分开，阻塞任务不会卡住 loop 上的其他连接
+ * 每个工作线程有自己的任务队列，submit 轮流放到各个队列中
+ * 工作线程从自己队列的头部取任务，自己的队列空了之后从其他队列的尾部偷取，某个任务耗时很长时它后面的任务由空闲线程接手
+ * 所有队列都空时在条件变量上睡眠，只有存在睡眠的线程时 submit 才需要加锁通知
+ */
+class WorkerPool : noncopyable
+{
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkerPool(const std::string &name = std::string("WorkerPool"));
+    // 析构时先执行完已经提交的任务再退出
+    ~WorkerPool();
+
+    // 需要在 start 之前设置
+    void setThreadNum(int numThreads) { numThreads_ = numThreads; }
+    void start();
+    // 执行完已经提交的任务之后停止所有线程，之后提交的任务不再执行
+    void stop();
+
+    // 可以在任意线程中调用，start 之前调用会 LOG_FATAL ，stop 之后提交的任务被丢弃
+    void submit(Task task);
+
+    int numThreads() const { return numThreads_; }
+    // 还没有开始执行的任务数
+    int64_t pendingTasks() const { return pending_.load(std::memory_order_relaxed); }
+    // 从其他线程的队列中偷取执行的任务数
+    int64_t stolenTasks() const { return stolen_.load(std::memory_order_relaxed); }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerThread(size_t index);
+    // 从自己的队列头部取一个任务
+    bool pop(size_t index, Task *task);
+    // 从其他线程的队列尾部偷一个任务
+    bool steal(size_t index, Task *task);
+
+    std::string name_;
+    int numThreads_;
+    bool started_;
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::unique_ptr<Thread>> threads_;
+    std::atomic<size_t> next_;          // 下一个任务放入的队列
+    std::atomic<int64_t> pending_;      // 所有队列中的任务总数
+    std::atomic<int64_t> stolen_;
+    std::atomic_bool running_;
+
+    std::mutex sleepMutex_;
+    std::condition_variable sleepCond_;
+    std::atomic_int sleepers_;          // 正在或者即将在 sleepCond_ 上睡眠的线程数
+};
+
+#endif // WORKER_POOL_H
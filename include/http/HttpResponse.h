@@ -20,7 +20,7 @@ public:
         k404NotFound = 404,
     };  
 
-    explicit HttpResponse(bool close) : statusCode_(kUnknown), closeConnection_(close) { }
+    explicit HttpResponse(bool close) : statusCode_(kUnknown), bodyLen_(0), closeConnection_(close) { }
 
     void setStatusCode(HttpStatusCode code) { statusCode_ = code; } 
     void setStatusMessage(const std::string& message) { statusMessage_ = message; }   
@@ -30,19 +30,30 @@ public:
         ::strcpy(tmpBody.get(), body.data());  
         setBody(tmpBody , body.size()) ;
     } 
-    void setBody(const std::shared_ptr<char>& body , size_t len) { body_ = body ; bodyLen_ = len ; }  
+    void setBody(const std::shared_ptr<char>& body , size_t len) { body_ = body ; bodyLen_ = len ; bodyFile_.reset() ; }  
+    // 响应体使用整个文件，由 HttpServer 通过 TcpConnection::sendFile 发送，不会拷贝到用户态缓冲区
+    // 文件不存在或者不是普通文件时返回 false
+    bool setBodyFile(const std::string& path) ;
+    // 响应体对应的文件 fd ，没有设置时为 -1
+    int bodyFile() const { return bodyFile_ ? *bodyFile_ : -1; }
+    // 内存中的响应体，没有设置时为空
+    const std::shared_ptr<char>& body() const { return body_; }
+    size_t bodyLength() const { return bodyLen_; }
     void setContentType(const std::string& contentType) { addHeader("Content-Type", contentType); } 
 
     bool closeConnection() const { return closeConnection_; }
     void addHeader(const std::string& key, const std::string& value) { headers_[key] = value; }  
     void appendHeaderToBuffer(Buffer* output) const ;
     void appendBodyToBuffer(Buffer* output) const ;
+    // 只写入 Content-Length 和头部结束的空行，响应体由调用方单独发送
+    void appendBodyHeaderToBuffer(Buffer* output) const ;
 
 private: 
     std::unordered_map<std::string, std::string> headers_;
     HttpStatusCode statusCode_; 
     std::string statusMessage_;
     std::shared_ptr<char> body_ ;
+    std::shared_ptr<int> bodyFile_ ;   // 析构时关闭文件
     size_t bodyLen_ ; 
     bool closeConnection_;
 }; 
@@ -3,6 +3,7 @@
 
 #include "../net/TcpServer.h"
 #include "../base/noncopyable.h"
+#include "../base/WorkerPool.h"
 #include "../log/Logging.h" 
 
 class HttpRequest;
@@ -11,6 +12,10 @@ class HttpServer : noncopyable
 {
 public:
     using HttpCallback = std::function<void (const HttpRequest&, HttpResponse*)>;
+    // 返回 true 的请求会阻塞(查询数据库、签名等)，交给工作线程池执行 HttpCallback
+    using BlockingFilter = std::function<bool (const HttpRequest&)>;
+
+    static const int kDefaultWorkerThreads = 4;
 
     HttpServer(EventLoop *loop,
             const InetAddress& listenAddr,
@@ -21,7 +26,41 @@ public:
 
     void setHttpCallback(const HttpCallback& cb) { httpCallback_ = cb; }
 
-    void start() { server_.start() ; }
+    /**
+     * 标记会阻塞的请求，必须在 start 之前设置，工作线程池只在 start 时看到 filter 才会启动，
+     * start 之后才设置时第一个阻塞请求会因为线程池没有启动而 LOG_FATAL
+     * 请求仍然在 IO loop 中解析，filter 返回 true 时 httpCallback_ 在工作线程池中执行，响应再投递回连接所在的 loop 发送
+     * 请求执行期间暂停读取该连接，同一个连接上的响应保持请求的顺序
+     * httpCallback_ 需要能够在多个线程中同时调用
+     */
+    void setBlockingFilter(const BlockingFilter& filter) { blockingFilter_ = filter; }
+    // 所有请求都交给工作线程池执行，同样必须在 start 之前设置
+    void setBlockingHttpCallback(const HttpCallback& cb)
+    {
+        httpCallback_ = cb;
+        blockingFilter_ = [](const HttpRequest&) { return true; };
+    }
+    // 工作线程数，需要在 start 之前设置，只有设置了阻塞请求时才会创建线程
+    void setWorkerThreads(int numThreads) { workerPool_.setThreadNum(numThreads); }
+    WorkerPool& workerPool() { return workerPool_; }
+
+    // 设置 keep-alive 连接的空闲超时时间(秒)
+    void setIdleTimeout(int seconds) { server_.setIdleTimeout(seconds); }
+
+    /**
+     * 监听 socket 和连接的参数，需要在 start 之前设置
+     * 默认开启 TCP_DEFER_ACCEPT ，HTTP 客户端总是先发送请求，连接在请求到达之后才被 accept ，
+     * 省掉一次只为建立连接而唤醒 loop 的过程
+     */
+    void setSocketOptions(const SocketOptions &options) { server_.setSocketOptions(options); }
+
+    // 所有 loop 开启忙轮询，见 TcpServer::setBusyPoll
+    void setBusyPoll(int spinMicros) { server_.setBusyPoll(spinMicros); }
+
+    // 所有 loop 每轮的调度预算，见 TcpServer::setRoundBudget
+    void setRoundBudget(int maxChannels, int maxFunctors, int maxMicros = 0) { server_.setRoundBudget(maxChannels, maxFunctors, maxMicros); }
+
+    void start();
 
 private:
     void onConnection(const TcpConnectionPtr& conn);
@@ -29,9 +68,15 @@ private:
                     Buffer *buf,
                     Timestamp receiveTime);
     void onDealRequest(const TcpConnectionPtr&, const HttpRequest&);
+    // 在工作线程中执行请求，响应投递回连接所在的 loop
+    void onBlockingRequest(const TcpConnectionPtr&, const std::shared_ptr<HttpRequest>&);
+    // 发送响应，不访问 HttpServer 的成员，HttpServer 析构之后 loop 中剩下的回调仍然可以安全执行
+    static void sendResponse(const TcpConnectionPtr&, const HttpResponse&);
 
     TcpServer server_;
     HttpCallback httpCallback_;
+    BlockingFilter blockingFilter_;
+    WorkerPool workerPool_;     // 声明在 server_ 之后，先于 loop 停止，执行完的请求仍然可以投递到 loop
 };
 
 #endif  
\ No newline at end of file
@@ -1,23 +1,37 @@
 #ifndef ACCEPTOR_H
 #define ACCEPTOR_H
 
+#include <atomic>
+#include <vector>
+#include <stdint.h>
+
 #include "Socket.h"
 #include "Channel.h"
+#include "SocketOptions.h"
 
 // 前置声明，可以不引用头文件暴露文件信息
 class EventLoop;
 class InetAddress;
 
 /**
- * Acceptor 运行在 mainLoop 中
+ * Acceptor 默认运行在 mainLoop 中
  * TcpServer发现 Acceptor 有一个新连接，则将此 Channel 分发给一个 subLoop
+ * TcpServer 使用每个 loop 独立监听的模式时，每个 subLoop 各有一个 Acceptor ，新连接直接在本 loop 中建立
 */
 class Acceptor : noncopyable
 {
 public : 
     // 接受新连接的会执行的回调函数
     using NewConnectionCallback = std::function<void(int sockfd, const InetAddress&)> ;
+    // 新连接准入检查，返回 false 时连接被接收后立即关闭
+    using AdmissionCallback = std::function<bool()> ;
+
+    // 每次可读事件最多接收的连接数
+    static const int kDefaultMaxAcceptsPerRound = 64;
+
     Acceptor(EventLoop *loop, const InetAddress &ListenAddr, bool reuseport);
+    // 接管一个已经 bind 好的监听 socket(例如 dup 出来的 fd)，exclusive 为 true 时以 EPOLLEXCLUSIVE 注册
+    Acceptor(EventLoop *loop, int listenfd, bool exclusive);
     ~Acceptor();
 
     // 主要是在 TcpServer 设置新连接到来，需要执行的回调函数，
@@ -26,19 +40,51 @@ public :
         NewConnectionCallback_ = cb;
     }
 
+    void setAdmissionCallback(const AdmissionCallback &cb) { admissionCallback_ = cb; }
+
+    // 设置每次可读事件最多接收的连接数，需要在 listen 之前设置
+    void setMaxAcceptsPerRound(int n) { maxAcceptsPerRound_ = n > 0 ? n : 1; }
+
+    // 监听 socket 的参数，需要在 listen 之前设置
+    void setSocketOptions(const SocketOptions &options) { options_ = options; }
+
     bool listenning() const { return listenning_; }
 
+    // 统计计数，可以在其他线程中读取
+    int64_t acceptedCount() const { return acceptedCount_.load(std::memory_order_relaxed); }   // 成功建立的连接数
+    int64_t shedCount() const { return shedCount_.load(std::memory_order_relaxed); }           // 接收后立即关闭的连接数
+    int64_t emfileCount() const { return emfileCount_.load(std::memory_order_relaxed); }       // fd 耗尽(EMFILE/ENFILE)的次数
+
+    int fd() const { return acceptSocket_.fd(); }
+
     void listen() ;
 
 private :
 
     void handleRead();
+    // io_uring 的 multishot accept 返回的新连接 fd 或者 -errno ，先保存下来，在 handleRead 中统一处理
+    void handleAcceptCompletion(int res, const char *data);
+    void handleCompletedAccepts();
+    // 准入检查之后交给 TcpServer
+    void newConnection(int connfd, const InetAddress &peerAddr);
+    // fd 耗尽时用预留的 fd 接收一个连接并立即关闭，避免水平触发下监听 socket 一直可读导致 busy loop
+    // 返回是否丢弃了一个连接
+    bool shedWithIdleFd();
 
     EventLoop *loop_; // Acceptor用的就是用户定义的BaseLoop
     Socket acceptSocket_;
     Channel acceptChannel_;
     NewConnectionCallback NewConnectionCallback_;
+    AdmissionCallback admissionCallback_;
     bool listenning_; // 是否正在监听的标志
+    int maxAcceptsPerRound_;
+    SocketOptions options_;
+    int idleFd_;      // 预留的空闲 fd ，打开的是 /dev/null
+    std::vector<int> completedAccepts_;     // Poller 已经完成、还没有处理的 accept 结果
+
+    std::atomic<int64_t> acceptedCount_;
+    std::atomic<int64_t> shedCount_;
+    std::atomic<int64_t> emfileCount_;
 };
 
 #endif
\ No newline at end of file
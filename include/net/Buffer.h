@@ -40,6 +40,8 @@ public:
      * wreaderIndex_
      */    
     size_t prependableBytes() const { return readerIndex_; }
+    // 底层 vector 的大小，包括 prependable 部分
+    size_t internalCapacity() const { return buffer_.size(); }
 
     // 返回缓冲区中可读数据的起始地址
     const char* peek() const
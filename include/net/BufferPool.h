@@ -0,0 +1,32 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <memory>
+#include <vector>
+#include "../base/noncopyable.h"
+#include "../net/Buffer.h"
+
+/**
+ * 每个 EventLoop 一个的空闲 Buffer 池，只在 loop 线程中使用，不加锁
+ * TcpConnection 在有数据可读时才取出接收缓冲区，数据被上层全部取走之后归还，
+ * 大量空闲连接(例如长连接上的 WebSocket)不再各自占用一块缓冲区
+ */
+class BufferPool : noncopyable
+{
+public:
+    static const size_t kMaxPooledBuffers = 256;        // 最多缓存的空闲 Buffer 数
+    // 超过这个容量的 Buffer 不回收，突发的大请求之后不会长期占用内存
+    // TcpConnection 读取时最多预留 kMaxReadSize(64KB) 的可写空间，加上 kCheapPrepend 才是这时缓冲区的大小，需要能够回收
+    static const size_t kMaxPooledCapacity = 64 * 1024 + Buffer::kCheapPrepend;
+
+    std::unique_ptr<Buffer> acquire();
+    // 清空之后放回池中，池满或者容量太大时直接释放
+    void release(std::unique_ptr<Buffer> buffer);
+
+    size_t size() const { return free_.size(); }
+
+private:
+    std::vector<std::unique_ptr<Buffer>> free_;
+};
+
+#endif // BUFFER_POOL_H
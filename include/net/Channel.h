@@ -19,6 +19,21 @@ class Channel : noncopyable
 public : 
     using EventCallback = std::function<void()> ;
     using ReadEventCallback = std::function<void(Timestamp)> ;
+    // Poller 代替读事件直接完成的 accept/recv 结果，res 是新连接的 fd 、收到的字节数，0 表示对端关闭，负数是 -errno
+    using CompletionCallback = std::function<void(int res, const char *data)> ;
+
+    /**
+     * 读事件的处理方式，需要在注册到 Poller 之前设置
+     * kReadReadiness : Poller 只通知可读，由回调自己 accept/read
+     * kReadAccept/kReadRecv : 支持的 Poller(io_uring)直接完成 accept 或者 recv ，在 poll 返回之前把结果交给 CompletionCallback ，
+     *                         之后和普通读事件一样调用 ReadEventCallback ，不支持时仍然按 kReadReadiness 处理
+     */
+    enum ReadMode
+    {
+        kReadReadiness,
+        kReadAccept,
+        kReadRecv,
+    };
 
     Channel(EventLoop *loop, int fd) ;
     ~Channel() ;
@@ -30,10 +45,20 @@ public :
     void setWriteCallback(EventCallback cb) { writeCallback_ = std::move(cb); }
     void setCloseCallback(EventCallback cb) { closeCallback_ = std::move(cb); }
     void setErrorCallback(EventCallback cb) { errorCallback_ = std::move(cb); }
+    void setCompletionCallback(CompletionCallback cb) { completionCallback_ = std::move(cb); }
 
     int fd() const { return fd_; }                    // 返回封装的fd
     int events() const { return events_; }            // 返回在监听的具体感兴趣的事件
     void set_revents(int revt) { revents_ = revt; }   // 主要是提供给 Poller ，设置返回的发生事件
+    int revents() const { return revents_; }
+
+    void setReadMode(ReadMode mode) { readMode_ = mode; }
+    ReadMode readMode() const { return readMode_; }
+    // Poller 注册时决定是否由它直接完成读操作，为 true 时读回调不能再自己读 fd ，否则会和内核中的请求抢数据
+    void setCompletionReads(bool on) { completionReads_ = on; }
+    bool completionReads() const { return completionReads_; }
+    // 由 Poller 在 loop 线程中调用
+    void handleCompletion(int res, const char *data) { completionCallback_(res, data); }
 
     // 设置fd相应的事件状态，update() 其本质调用 epoll_ctl 设置对应 epoll 需要监听的 fd_ 上发生的事件
     void enableReading() { events_ |= kReadEvent; update(); }
@@ -41,21 +66,22 @@ public :
     void enableWriting() { events_ |= kWriteEvent; update(); }
     void disableWriting() { events_ &= ~kWriteEvent; update(); }
     void disableAll() { events_ &= kNoneEvent; update(); }
+    // 同时注册读写事件，只需要一次 epoll_ctl
+    void enableReadingAndWriting() { events_ |= kReadEvent | kWriteEvent; update(); }
+
+    // 是否以边缘触发(EPOLLET)模式注册到 Epoller 上，需要在注册事件之前设置
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+    bool isEdgeTriggered() const { return edgeTriggered_; }
+
+    // 是否以 EPOLLEXCLUSIVE 方式注册，多个 epoll 监听同一个 fd 时每次只唤醒其中一个，需要在注册事件之前设置
+    void setExclusive(bool on) { exclusive_ = on; }
+    bool isExclusive() const { return exclusive_; }
 
      // 返回fd当前被 Epoller 监听的事件状态
     bool isNoneEvent() const { return events_ == kNoneEvent; }
     bool isWriting() const { return events_ & kWriteEvent; }
     bool isReading() const { return events_ & kReadEvent; }
 
-    /**
-     * for Epoller
-     * const int kNew = -1;     // fd 还未被 Epoller 监视 
-     * const int kAdded = 1;    // fd 正被 Epoller 监视中
-     * const int kDeleted = 2;  // fd 被移除 Epoller
-    */ 
-    int index() { return index_; }
-    void set_index(int idx) { index_ = idx; }
-
     // one loop one thread
     EventLoop* ownerLoop() { return loop_; }
     void remove();
@@ -77,7 +103,10 @@ private :
     const int fd_;      // fd, Poller 监听对象，此 Channel 可以理解为是该 fd_ 的保姆
     int events_;        // 注册fd感兴趣的事件
     int revents_;       // Poller 返回的具体发生的事件, 获知 fd 最终发生的具体的事件 revents
-    int index_;         // 在 Poller 上注册的情况
+    bool edgeTriggered_;// 是否使用边缘触发模式
+    bool exclusive_;    // 是否使用 EPOLLEXCLUSIVE 注册
+    ReadMode readMode_;
+    bool completionReads_;  // Poller 是否直接完成读操作
 
     // 非常巧妙的操作，弱指针指向TcpConnection(必要时升级为shared_ptr多一份引用计数，避免用户误删)
     // tied_ 标记此 Channel 是否被调用过 Channel::tie 方法
@@ -89,6 +118,7 @@ private :
     EventCallback writeCallback_;
     EventCallback closeCallback_;
     EventCallback errorCallback_;
+    CompletionCallback completionCallback_;
 };
 
 #endif
\ No newline at end of file
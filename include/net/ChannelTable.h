@@ -0,0 +1,87 @@
+#ifndef CHANNEL_TABLE_H
+#define CHANNEL_TABLE_H
+
+#include <vector>
+#include <stddef.h>
+
+class Channel;
+
+/**
+ * Poller 中 fd 到 Channel 的映射，fd 是进程内从小到大分配的整数，直接用 fd 作为下标
+ * 每个槽位是 Channel 指针和它在 Poller 上的注册状态，查找、注册和移除都不需要哈希和分配节点
+ * 出现更大的 fd 时按两倍扩容，只在注册时发生，表的大小和进程中最大的 fd 成正比
+ * 只在所属 loop 线程中访问
+ */
+class ChannelTable
+{
+public:
+    struct Slot
+    {
+        Channel *channel;   // 没有注册时为 nullptr
+        int state;          // Poller 定义的注册状态，channel 为空时没有意义
+    };
+
+    ChannelTable()
+        : count_(0)
+    {
+    }
+
+    // 返回 fd 上注册的 Channel ，没有时返回 nullptr
+    Channel* find(int fd) const
+    {
+        return static_cast<size_t>(fd) < slots_.size() ? slots_[fd].channel : nullptr;
+    }
+
+    // 返回 fd 的槽位，超出范围时扩容，新槽位的 channel 为 nullptr
+    Slot& slot(int fd)
+    {
+        if (static_cast<size_t>(fd) >= slots_.size())
+        {
+            grow(fd);
+        }
+        return slots_[fd];
+    }
+
+    // 把 channel 放到 fd 的槽位中
+    void insert(int fd, Channel *channel, int state)
+    {
+        Slot &s = slot(fd);
+        if (s.channel == nullptr)
+        {
+            ++count_;
+        }
+        s.channel = channel;
+        s.state = state;
+    }
+
+    void erase(int fd)
+    {
+        if (static_cast<size_t>(fd) < slots_.size() && slots_[fd].channel != nullptr)
+        {
+            slots_[fd].channel = nullptr;
+            --count_;
+        }
+    }
+
+    // 已经注册的 Channel 个数
+    size_t size() const { return count_; }
+
+private:
+    void grow(int fd)
+    {
+        size_t n = slots_.empty() ? kInitialSize : slots_.size();
+        while (n <= static_cast<size_t>(fd))
+        {
+            n *= 2;
+        }
+        Slot empty = { nullptr, 0 };
+        slots_.resize(n, empty);
+    }
+
+    static const size_t kInitialSize = 64;
+
+    std::vector<Slot> slots_;
+    size_t count_;
+};
+
+#endif // CHANNEL_TABLE_H
@@ -0,0 +1,59 @@
+#ifndef CONNECTION_REGISTRY_H
+#define CONNECTION_REGISTRY_H
+
+#include <vector>
+#include <stdint.h>
+#include "../base/noncopyable.h"
+#include "../net/Callback.h"
+
+/**
+ * 按连接 ID 索引的连接表，代替以连接名字为键的 unordered_map
+ * ID 是 64 位整数，低 24 位是槽位下标，接下来 8 位是分片编号，高 32 位是槽位的代数，槽位每次释放代数加一
+ * 连接关闭之后旧的 ID 不会再查到复用同一个槽位的新连接，通过 ID 可以直接找到连接所在的分片
+ * 不是线程安全的，由调用方加锁
+ */
+class ConnectionRegistry : noncopyable
+{
+public:
+    static const uint32_t kMaxShards = 1 << 8;
+    static const uint32_t kMaxSlots = 1 << 24;
+
+    explicit ConnectionRegistry(uint32_t shard = 0) : shard_(shard), size_(0) { }
+
+    // 保存连接，返回分配的 ID ，ID 不会是 0
+    uint64_t add(const TcpConnectionPtr &conn);
+    // 移除连接，ID 已经失效时返回 false
+    bool remove(uint64_t id);
+    // 查找连接，ID 已经失效时返回空指针
+    TcpConnectionPtr find(uint64_t id) const;
+    // 取出所有连接并清空
+    std::vector<TcpConnectionPtr> takeAll();
+
+    size_t size() const { return size_; }
+
+    static uint32_t slotOf(uint64_t id) { return static_cast<uint32_t>(id) & (kMaxSlots - 1); }
+    static uint32_t shardOf(uint64_t id) { return static_cast<uint32_t>(id) >> 24; }
+    static uint32_t generationOf(uint64_t id) { return static_cast<uint32_t>(id >> 32); }
+
+private:
+    struct Slot
+    {
+        uint32_t generation;
+        TcpConnectionPtr conn;
+    };
+
+    const Slot* lookup(uint64_t id) const;
+    uint64_t makeId(uint32_t index) const
+    {
+        return (static_cast<uint64_t>(slots_[index].generation) << 32) | (shard_ << 24) | index;
+    }
+    // 清空槽位，代数加一之后放入空闲列表
+    void release(uint32_t index);
+
+    const uint32_t shard_;
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> freeSlots_;
+    size_t size_;
+};
+
+#endif // CONNECTION_REGISTRY_H
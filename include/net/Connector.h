@@ -0,0 +1,96 @@
+#ifndef CONNECTOR_H
+#define CONNECTOR_H
+
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <random>
+
+#include "../base/noncopyable.h"
+#include "../net/InetAddress.h"
+#include "../net/TimerId.h"
+#include "../net/SocketOptions.h"
+
+class Channel;
+class EventLoop;
+
+/**
+ * 和 Acceptor 对应的主动连接器，TcpClient 使用
+ * 非阻塞 connect 之后通过 Channel 等待 socket 可写，可写时检查 SO_ERROR 判断连接是否成功
+ * 连接失败或者超时之后按指数退避重试，每次等待时间在 [delay/2, delay] 之间随机，避免大量客户端同时重连
+ * 连接成功后把 sockfd 交给 NewConnectionCallback ，之后 Connector 不再管理这个 fd
+ */
+class Connector : noncopyable,
+    public std::enable_shared_from_this<Connector>
+{
+public:
+    using NewConnectionCallback = std::function<void(int sockfd)>;
+
+    static const int kDefaultInitRetryDelayMs = 500;
+    static const int kDefaultMaxRetryDelayMs = 30 * 1000;
+
+    Connector(EventLoop *loop, const InetAddress &serverAddr);
+    ~Connector();
+
+    void setNewConnectionCallback(const NewConnectionCallback &cb) { newConnectionCallback_ = cb; }
+
+    // 单次 connect 等待的最长时间(秒)，超时按失败处理，<= 0 表示不限制，需要在 start 之前设置
+    void setConnectTimeout(double seconds) { connectTimeout_ = seconds; }
+    // 重试等待时间的初始值和上限(毫秒)，需要在 start 之前设置
+    void setRetryDelay(int initMs, int maxMs)
+    {
+        initRetryDelayMs_ = initMs;
+        maxRetryDelayMs_ = maxMs;
+        retryDelayMs_ = initMs;
+    }
+
+    // 在 connect 之前设置的 socket 参数，目前只使用缓冲区大小，需要在 start 之前设置
+    void setSocketOptions(const SocketOptions &options) { options_ = options; }
+
+    const InetAddress& serverAddress() const { return serverAddr_; }
+
+    void start();   // 可以在任意线程中调用
+    void restart(); // 必须在 loop 线程中调用，重置退避时间之后重新连接
+    void stop();    // 可以在任意线程中调用
+
+private:
+    enum States
+    {
+        kDisconnected,
+        kConnecting,
+        kConnected
+    };
+
+    void setState(States s) { state_ = s; }
+    void startInLoop();
+    void stopInLoop();
+    void connect();
+    void connecting(int sockfd);
+    void handleWrite();
+    void handleError();
+    void retry(int sockfd);
+    // 连接超时，weak_ptr 避免定时器延长 Connector 的生命周期
+    static void handleTimeout(const std::weak_ptr<Connector> &weakConnector, int sockfd);
+    static void startAfterDelay(const std::weak_ptr<Connector> &weakConnector);
+    // 从 Poller 中移除 Channel 并返回 sockfd ，Channel 在回调结束之后才释放
+    int removeAndResetChannel();
+    void resetChannel();
+
+    EventLoop *loop_;
+    InetAddress serverAddr_;
+    std::atomic_bool connect_;      // 是否需要连接，stop 之后为 false
+    std::atomic_int state_;
+    std::unique_ptr<Channel> channel_;
+    NewConnectionCallback newConnectionCallback_;
+
+    double connectTimeout_;
+    TimerId timeoutTimer_;
+    TimerId retryTimer_;
+    int initRetryDelayMs_;
+    int maxRetryDelayMs_;
+    int retryDelayMs_;              // 下一次重试的退避时间上限
+    SocketOptions options_;
+    std::minstd_rand random_;
+};
+
+#endif // CONNECTOR_H
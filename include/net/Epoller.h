@@ -2,34 +2,30 @@
 #define Epoller_H
 
 #include <vector>
-#include <unordered_map>
 #include <sys/epoll.h>
 #include <unistd.h>
 #include "../base/noncopyable.h"
 #include "../net/Channel.h"
+#include "../net/Poller.h"
 
 
-class Epoller : noncopyable
+class Epoller : public Poller
 {
 public:
     using EventList = std::vector<epoll_event> ;
-    using ChannelList = std::vector<Channel*> ;
     
     Epoller(EventLoop *Loop) ;
-    ~Epoller() ;
+    ~Epoller() override ;
 
-    Timestamp epollWait(int timeoutMs, ChannelList *activeChannels) ;
-    void updateChannel(Channel *channel) ;
-    void removeChannel(Channel *channel) ; 
-    bool hasChannel(Channel *channel) const; // 判断 channel是否注册到 poller当中
+    Timestamp poll(int timeoutMs, ChannelList *activeChannels) override ;
+    void updateChannel(Channel *channel) override ;
+    void removeChannel(Channel *channel) override ; 
 
 private:
-    static const int kNew = -1  ; // 未添加在 Epoller 中
-    static const int kAdded = 1 ; // 已添加在 Epoller 中
-    static const int kDeleted = 2;// 已删除在 Epoller 中
-
     // 一次监听最大能返回事件数量
     static const int kInitEventListSize = 16; 
+    // fillActiveChannels 提前预取的 channel 个数
+    static const int kPrefetchDistance = 4;
 
     // 填充活跃的连接
     void fillActiveChannels(int numEvents, ChannelList *activeChannels) const;
@@ -38,10 +34,6 @@ private:
 
     int epollfd_;           // epoll_create在内核创建空间返回的fd
     EventList events_;      // 用于存放epoll_wait返回的所有发生的事件的文件描述符
-
-    EventLoop *ownerLoop_;  // 定义Poller所属的事件循环EventLoop
-    using ChannelMap = std::unordered_map<int, Channel*> ;
-    ChannelMap channels_ ;  // 储存 channel 的映射，（sockfd -> channel*）
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -1,24 +1,52 @@
 #ifndef EVENTLOOP_H
 #define EVENTLOOP_H
 
-#include <mutex>
 #include <atomic>
 #include <memory>
 #include <vector>
+#include <deque>
 #include <functional>
 #include "../base/Timestamp.h"
 #include "../base/CurrentThread.h"
 #include "../base/noncopyable.h"
+#include "../base/MpscQueue.h"
+#include "../net/TimerId.h"
+#include "../net/LoopMetrics.h"
 
 class Channel ; 
-class Epoller ; 
+class Poller ; 
+class TimerQueue ; 
+class BufferPool ; 
 
 // 事件循环类，作为 channel 和 epoller 的桥梁
 class EventLoop : noncopyable
 {
 public : 
     using Functor = std::function<void()> ;
-    EventLoop()  ;
+
+    // IO 复用的后端
+    enum Backend
+    {
+        kEpoll,     // epoll_wait + epoll_ctl
+        kIoUring,   // io_uring ，内核不支持时自动退回 epoll
+    };
+
+    /**
+     * 跨线程回调的优先级
+     * kControl 用于连接的建立和销毁，每轮在处理 channel 之前和执行普通回调之前全部执行，不受预算限制
+     * kBulk 是普通回调，按预算分批执行，同一优先级内保持投递顺序
+     * kControl 回调会插到更早投递、还没有执行的 kBulk 回调前面，只能用于不依赖普通回调顺序的操作
+     */
+    enum Priority
+    {
+        kControl,
+        kBulk,
+    };
+
+    // 默认后端由环境变量 TINY_WEBSERVER_POLLER 决定，设置为 io_uring 时使用 kIoUring
+    static Backend defaultBackend();
+
+    explicit EventLoop(Backend backend = defaultBackend())  ;
     ~EventLoop() ;
 
     void loop();
@@ -27,7 +55,7 @@ public :
     Timestamp pollReturnTime() const { return pollReturnTime_; }
 
     // 在当前线程同步调用函数
-    void runInLoop(Functor cb);
+    void runInLoop(Functor cb, Priority priority = kBulk);
     /**
      * 把cb放入队列，唤醒loop所在的线程执行cb
      * 
@@ -35,8 +63,9 @@ public :
      * 在mainLoop中获取subLoop指针，然后调用相应函数
      * 在queueLoop中发现当前的线程不是创建这个subLoop的线程，将此函数装入subLoop的pendingFunctors容器中
      * 之后mainLoop线程会调用subLoop::wakeup向subLoop的eventFd写数据，以此唤醒subLoop来执行pengdingFunctors
+     * 只有 subLoop 正阻塞在 epoll_wait 中(sleeping_ 为 true)时才需要写 eventFd 唤醒
      */
-    void queueInLoop(Functor cb);
+    void queueInLoop(Functor cb, Priority priority = kBulk);
 
     // 用来唤醒loop所在的线程
     void wakeup();
@@ -50,34 +79,71 @@ public :
     bool isInLoopThread() const { return threadId_ == CurrentThread::tid(); }
 
     /**
-     * TODO : 定时任务相关函数
+     * 定时任务相关函数，都是线程安全的，可以在其他线程调用
+     * runAt 在 time 时刻执行 cb
+     * runAfter 在 delay 秒之后执行 cb
+     * runEvery 每隔 interval 秒执行一次 cb
      */
-    // void runAt(Timestamp timestamp, Functor&& cb) {
-    //     timerQueue_->addTimer(std::move(cb), timestamp, 0.0);
-    // }
+    TimerId runAt(Timestamp time, Functor cb);
+    TimerId runAfter(double delay, Functor cb);
+    TimerId runEvery(double interval, Functor cb);
+    // 取消定时器
+    void cancel(TimerId timerId);
 
-    // void runAfter(double waitTime, Functor&& cb) {
-    //     Timestamp time(addTime(Timestamp::now(), waitTime)); 
-    //     runAt(time, std::move(cb));
-    // }
+    /**
+     * 负载统计，可以在其他线程中读取，EventLoopThreadPool 根据这些计数选择 loop
+     * numConnections 由 TcpServer 在连接分配到该 loop 和连接移除时更新
+     * loopLagMicros 是最近几轮事件处理耗时的滑动平均(微秒)，loop 阻塞在 poll 中时为 0
+     */
+    void addConnectionCount(int delta) { numConnections_.fetch_add(delta, std::memory_order_relaxed); }
+    int numConnections() const { return numConnections_.load(std::memory_order_relaxed); }
+    int64_t loopLagMicros() const;
 
-    // void runEvery(double interval, Functor&& cb) {
-    //     Timestamp timestamp(addTime(Timestamp::now(), interval)); 
-    //     timerQueue_->addTimer(std::move(cb), timestamp, interval);
-    // }
+    /**
+     * 低延迟模式，可以在任意线程中调用，下一轮循环生效，0 表示关闭
+     * 处理完一轮事件之后先用 timeout 为 0 的 poll 忙轮询最多 spinMicros 微秒，期间到达的事件和回调不需要唤醒线程
+     * 忙轮询没有等到事件时才阻塞；连续落空时忙轮询时间减半，等到事件时加倍，最长 spinMicros
+     * 没有流量的 loop 阻塞在 poll 中，和关闭时一样不消耗 CPU
+     */
+    void setBusyPoll(int spinMicros);
+    int busyPollMicros() const { return busyPollMicros_.load(std::memory_order_relaxed); }
+
+    /**
+     * 每轮循环的调度预算，可以在任意线程中调用，0 表示不限制，默认都不限制
+     * maxChannels 是每轮最多处理的活跃 channel 数，超出的部分留到下一轮，处理完之前不再 poll
+     * maxFunctors 是每轮最多执行的 kBulk 回调数，超出的部分留到下一轮
+     * maxMicros 是处理 channel 和执行回调各自的时间上限，超时之后剩下的留到下一轮，每轮至少处理一个
+     * 大量跨线程回调不会饿死 socket IO ，一批密集的 IO 事件也不会让回调一直等待
+     */
+    void setRoundBudget(int maxChannels, int maxFunctors, int maxMicros = 0);
+
+    // 运行统计的快照，可以在任意线程中调用
+    LoopMetrics::Snapshot metrics() const;
+
+    // 该 loop 上连接共用的空闲接收缓冲区池，只能在 loop 线程中使用
+    BufferPool* bufferPool() { return bufferPool_.get(); }
 
 private : 
     void handleRead();
     void doPendingFunctors();
+    void doControlFunctors();
+    // 按预算处理 activeChannels_ 中从 nextActiveChannel_ 开始的 channel
+    void handleActiveChannels();
+    bool hasPendingFunctors() const;
+    // 记录刚执行完的一个 channel 回调或者跨线程回调的耗时，返回当前时间(微秒)
+    int64_t callbackDone();
+    // 忙轮询直到有事件、有回调或者用完 spinMicros_ ，按结果调整下一次的忙轮询时间
+    void busyPoll();
 
     using ChannelList = std::vector<Channel*>;
     std::atomic_bool looping_;  // 原子操作，通过CAS实现
     std::atomic_bool quit_;     // 标志退出事件循环
-    std::atomic_bool callingPendingFunctors_; // 标志当前loop是否有需要执行的回调操作
+    std::atomic_bool sleeping_; // 标志当前loop是否(即将)阻塞在epoll_wait中，为true时投递回调需要wakeup
     const pid_t threadId_;      // 记录当前loop所在线程的id
     Timestamp pollReturnTime_;  // poller返回发生事件的channels的返回时间
-    std::unique_ptr<Epoller> epoller_;
-    // std::unique_ptr<TimerQueue> timerQueue_;
+    std::unique_ptr<Poller> poller_;
+    std::unique_ptr<TimerQueue> timerQueue_;
+    std::unique_ptr<BufferPool> bufferPool_;
     
     /**
      * TODO:eventfd用于线程通知机制，libevent和我的webserver是使用sockepair
@@ -89,8 +155,23 @@ private :
 
     ChannelList activeChannels_;            // 活跃的Channel
     Channel* currentActiveChannel_;         // 当前处理的活跃channel
-    std::mutex mutex_;                      // 用于保护pendingFunctors_线程安全操作
-    std::vector<Functor> pendingFunctors_;  // 存储loop跨线程需要执行的所有回调操作
+    MpscQueue<Functor> pendingFunctors_;    // 存储loop跨线程需要执行的所有回调操作，无锁队列
+    MpscQueue<Functor> controlFunctors_;    // kControl 优先级的回调
+    std::deque<Functor> bulkFunctors_;      // 超出预算留到下一轮的回调，只由 loop 线程访问
+    size_t nextActiveChannel_;              // activeChannels_ 中下一个要处理的 channel ，小于 size 时下一轮不 poll
+
+    int maxChannelsPerRound_;               // 调度预算，只由 loop 线程读写
+    int maxFunctorsPerRound_;
+    int roundBudgetMicros_;
+
+    LoopMetrics metrics_;
+    int64_t callbackStartMicros_;           // 上一个回调结束的时间，只由 loop 线程读写
+
+    std::atomic_int numConnections_;        // 分配到该 loop 的连接数
+    std::atomic<int64_t> loopLagMicros_;    // 每轮事件处理耗时的滑动平均，只由 loop 线程写
+
+    std::atomic_int busyPollMicros_;        // 忙轮询时间的上限，0 表示关闭
+    int spinMicros_;                        // 下一次忙轮询的时间，只由 loop 线程读写
 } ; 
 
 #endif
\ No newline at end of file
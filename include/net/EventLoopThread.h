@@ -15,8 +15,10 @@ class EventLoopThread : noncopyable
 public:
     using ThreadInitCallback = std::function<void(EventLoop*)>;
 
+    // cpu >= 0 时线程绑定到该 CPU 上运行，EventLoop 在绑定之后才创建
     EventLoopThread(const ThreadInitCallback &cb = ThreadInitCallback(),
-                    const std::string &name = std::string());
+                    const std::string &name = std::string(),
+                    int cpu = -1);
 
     ~EventLoopThread();
 
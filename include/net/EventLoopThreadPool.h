@@ -5,29 +5,60 @@
 #include <vector>
 #include <memory>
 #include <functional>
+#include <random>
+#include <utility>
+#include <stdint.h>
+
+#include "../net/LoopMetrics.h"
 
 class EventLoop;
 class EventLoopThread;
+class InetAddress;
 
 class EventLoopThreadPool
 {
 public:
     // 用户传入的函数
     using ThreadInitCallback = std::function<void(EventLoop*)> ;
+
+    // 新连接选择 subLoop 的策略
+    enum LoadBalancePolicy
+    {
+        kRoundRobin,        // 轮询
+        kLeastConnections,  // 连接数最少的 loop
+        kLeastLoopLag,      // 事件处理延迟最小的 loop
+        kPowerOfTwoChoices, // 随机选两个 loop ，取连接数较少的一个
+        kConsistentHash,    // 按对端 ip 一致性哈希，同一个客户端总是落在同一个 loop 上，没有 ip 的对端(Unix 域)按轮询
+    };
+
     EventLoopThreadPool(EventLoop *baseLoop, const std::string &nameArg) ;
     ~EventLoopThreadPool() ;
 
     // 设置线程数量
     void setThreadNum(int numThreads) { numThreads_ = numThreads; }
 
+    // 设置 subLoop 线程绑定的 CPU ，第 i 个线程绑定到 cpus[i % cpus.size()]，为空表示不绑定，需要在 start 之前设置
+    // 每个物理核一个 loop 可以传入 Thread::physicalCoreCpus()
+    void setCpuAffinity(const std::vector<int> &cpus) { cpus_ = cpus; }
+
+    // 设置选择 subLoop 的策略，需要在 start 之前设置
+    void setLoadBalancePolicy(LoadBalancePolicy policy) { policy_ = policy; }
+    LoadBalancePolicy loadBalancePolicy() const { return policy_; }
+
     // 启动线程池
     void start(const ThreadInitCallback &cb = ThreadInitCallback()) ;
 
     // 如果工作在多线程中，baseLoop_(mainLoop)会默认以轮询的方式分配Channel给subLoop
     EventLoop *getNextLoop() ;
 
+    // 按照设置的策略为来自 peerAddr 的新连接选择 loop ，只在 baseLoop 中调用
+    EventLoop *getLoopForPeer(const InetAddress &peerAddr) ;
+
     std::vector<EventLoop *> getAllLoops() ;
 
+    // 所有 loop 的运行统计快照，顺序和 getAllLoops 一致，start 之后可以在任意线程中调用
+    std::vector<LoopMetrics::Snapshot> metrics() ;
+
     bool started() const { return started_; }
     const std::string name() const { return name_; }
     
@@ -39,5 +70,17 @@ private:
     size_t next_;          // 轮询的下标
     std::vector<std::unique_ptr<EventLoopThread>> threads_; // 保存所有的EventLoopThread容器
     std::vector<EventLoop *> loops_;    // 保存创建的所有EventLoop
+
+    // 一致性哈希环上每个 loop 的虚拟节点数
+    static const int kVirtualNodes = 64;
+    using HashRing = std::vector<std::pair<uint32_t, size_t>> ; // (哈希值, loops_ 下标) 按哈希值排序
+
+    // 构建一致性哈希环
+    void buildHashRing();
+
+    std::vector<int> cpus_;     // subLoop 线程绑定的 CPU 列表
+    LoadBalancePolicy policy_;  // 选择 subLoop 的策略
+    std::minstd_rand rng_;      // kPowerOfTwoChoices 使用的随机数
+    HashRing ring_;             // kConsistentHash 使用的哈希环
 };
 #endif // EVENT_LOOP_THREAD_POOL_H
\ No newline at end of file
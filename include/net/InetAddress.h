@@ -2,27 +2,76 @@
 #define INET_ADDRESS_H
 
 #include <string>
+#include <memory>
 #include <string.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
+/**
+ * socket 地址，支持 IPv4 、IPv6 和 Unix 域(AF_UNIX)
+ * IPv4/IPv6 地址直接保存在对象中；Unix 域地址的 sockaddr_un 有 110 字节，单独分配并由拷贝共享，
+ * 每个 TcpConnection 都保存两个地址，TCP 连接不需要为 Unix 域多付出内存
+ */
 class InetAddress
 {
 public:
+    // ip 中包含 ':' 时按 IPv6 解析，例如 "::" 可以同时监听 IPv4 和 IPv6(bindv6only 为 0 时)
     explicit InetAddress(uint16_t port = 8080, std::string ip = "127.0.0.1");
     explicit InetAddress(const sockaddr_in &addr)
-        : addr_(addr)
     {
+        ::memset(&addr6_, 0, sizeof(addr6_));
+        addr_ = addr;
     }
+    explicit InetAddress(const sockaddr_in6 &addr)
+        : addr6_(addr)
+    {
+    }
+    // addr 可以是三种地址族中的任意一种，len 是 accept/getsockname 等返回的地址长度
+    InetAddress(const sockaddr *addr, socklen_t len)
+    {
+        setSockAddr(addr, len);
+    }
+
+    /**
+     * Unix 域地址，path 以 '@' 开头时使用 Linux 的抽象命名空间(abstract namespace)，
+     * 不在文件系统中创建文件，最后一个引用关闭之后自动消失
+     * path 超过 sun_path 的长度(107 字节)时 LOG_FATAL
+     */
+    static InetAddress unixDomain(const std::string &path);
+
+    sa_family_t family() const { return addr_.sin_family; }
 
+    // IPv4/IPv6 返回 ip ，Unix 域返回路径，抽象命名空间以 '@' 开头，未命名的地址(例如客户端)返回空串
     std::string toIp() const;
+    // IPv4 是 ip:port ，IPv6 是 [ip]:port ，Unix 域是 unix:路径
     std::string toIpPort() const;
+    // Unix 域返回 0
     uint16_t toPort() const;
 
-    const sockaddr_in *getSockAddr() const { return &addr_; }
-    void setSockAddr(const sockaddr_in &addr) { addr_ = addr; }
+    const sockaddr *getSockAddr() const
+    {
+        return unix_ ? reinterpret_cast<const sockaddr *>(&unix_->addr) : reinterpret_cast<const sockaddr *>(&addr6_);
+    }
+    // bind/connect 等需要传入的地址长度
+    socklen_t getSockLen() const;
+    void setSockAddr(const sockaddr *addr, socklen_t len);
+
 private:
-    sockaddr_in addr_;
+    struct UnixAddress
+    {
+        sockaddr_un addr;
+        socklen_t len;
+    };
+
+    // Unix 域地址时 addr_.sin_family 同样是 AF_UNIX ，family() 不需要区分
+    union
+    {
+        sockaddr_in addr_;
+        sockaddr_in6 addr6_;
+    };
+    std::shared_ptr<const UnixAddress> unix_;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,109 @@
+#ifndef LOOP_METRICS_H
+#define LOOP_METRICS_H
+
+#include <atomic>
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+#include "../base/noncopyable.h"
+
+/**
+ * 单个 EventLoop 的运行统计，只由 loop 线程写入，其他线程随时可以通过 snapshot 读取
+ * 每个计数只有一个写者，用 relaxed 的 load + store 累加，不需要加锁，也没有原子读改写指令
+ * 快照中的各项计数不是在同一时刻读取的，相互之间可能有一轮的误差
+ */
+class LoopMetrics : noncopyable
+{
+public:
+    // 直方图的桶数，第 0 个桶是 0 ，第 i 个桶是 [2^(i-1), 2^i) ，超出范围的计入最后一个桶
+    static const int kBuckets = 24;
+    // 统计最慢回调的周期(微秒)
+    static const int64_t kIntervalMicros = 1000 * 1000;
+
+    // 直方图的快照
+    struct Histogram
+    {
+        int64_t counts[kBuckets];
+
+        int64_t total() const;
+        // 第 p (0 到 1)分位数所在桶的上界，没有样本时返回 0
+        int64_t percentile(double p) const;
+    };
+
+    struct Snapshot
+    {
+        int64_t iterations;             // 循环的轮数
+        int64_t pollMicros;             // 等待在 poll 中(包括忙轮询)的总时间
+        int64_t busyMicros;             // 处理 channel 和回调的总时间
+        int64_t wakeups;                // 被其他线程通过 eventfd 唤醒的次数
+        int64_t events;                 // 处理的活跃 channel 总数
+        int64_t functors;               // 执行的跨线程回调总数
+        int64_t backlog;                // 超出预算留到下一轮的回调数
+        int64_t slowestCallbackMicros;  // 最近一到两个统计周期内耗时最长的一个 channel 回调或者跨线程回调
+        int64_t currentRoundMicros;     // 当前这一轮已经处理了多久，阻塞在 poll 中时为 0 ，持续增长说明 loop 卡在某个回调中
+        Histogram activeChannels;       // 每次 poll 返回的活跃 channel 数
+        Histogram functorsPerRound;     // 每轮执行的回调数，也就是取出时的队列长度
+        Histogram roundMicros;          // 每轮处理的耗时
+
+        // poll 之外的时间占比，接近 1 说明 loop 已经饱和
+        double utilization() const;
+        std::string toString() const;
+    };
+
+    LoopMetrics();
+
+    // 下面的函数只能在 loop 线程中调用
+    // 一轮开始处理，nowMicros 是 poll 返回的时间
+    void startRound(int64_t nowMicros);
+    // poll 返回，pollMicros 是这次等待的时间，上一轮留下的 channel 没有处理完时这一轮不 poll
+    void recordPoll(int64_t pollMicros, size_t activeChannels);
+    // 一个 channel 回调或者跨线程回调执行完
+    void recordCallback(int64_t micros, int64_t nowMicros);
+    void recordFunctors(size_t count) { add(functors_, static_cast<int64_t>(count)); roundFunctors_ += count; }
+    // 一轮处理结束
+    void recordRound(int64_t busyMicros, size_t backlog);
+    void recordWakeup() { add(wakeups_, 1); }
+
+    // 可以在任意线程中调用
+    Snapshot snapshot(int64_t nowMicros) const;
+
+private:
+    class AtomicHistogram : noncopyable
+    {
+    public:
+        AtomicHistogram();
+        void add(int64_t value);
+        void load(Histogram *histogram) const;
+
+    private:
+        std::atomic<int64_t> counts_[kBuckets];
+    };
+
+    // 超过一个统计周期时把当前周期最慢的回调移到上一个周期
+    void rollInterval(int64_t nowMicros);
+
+    static void add(std::atomic<int64_t> &counter, int64_t delta)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    std::atomic<int64_t> iterations_;
+    std::atomic<int64_t> pollMicros_;
+    std::atomic<int64_t> busyMicros_;
+    std::atomic<int64_t> wakeups_;
+    std::atomic<int64_t> events_;
+    std::atomic<int64_t> functors_;
+    std::atomic<int64_t> backlog_;
+    std::atomic<int64_t> roundStartMicros_;     // 本轮 poll 返回的时间，阻塞在 poll 中时为 0
+    std::atomic<int64_t> slowestLastInterval_;  // 上一个统计周期内最慢的回调
+    std::atomic<int64_t> slowestThisInterval_;  // 当前统计周期内最慢的回调
+    AtomicHistogram activeChannels_;
+    AtomicHistogram functorsPerRound_;
+    AtomicHistogram roundMicros_;
+
+    // 只由 loop 线程访问
+    int64_t intervalStartMicros_;
+    size_t roundFunctors_;
+};
+
+#endif // LOOP_METRICS_H
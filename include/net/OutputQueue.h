@@ -0,0 +1,102 @@
+#ifndef OUTPUT_QUEUE_H
+#define OUTPUT_QUEUE_H
+
+#include <vector>
+#include <memory>
+#include <stdint.h>
+#include <sys/types.h>
+#include "../base/noncopyable.h"
+
+/**
+ * TcpConnection 的发送队列，由一串引用计数的数据块组成，发送时用 writev 一次提交多个块
+ * 1. append(data, len) 拷贝到队尾块的剩余空间中，不够时再分配新块，已经入队的数据不会再被移动或者重新分配
+ * 2. append(holder, data, len) 只引用 holder 持有的内存，不拷贝，发送完之后释放引用，头部和响应体可以分别入队
+ * 3. appendFile 排入一个文件片段，发送到这里时使用 sendfile ，文件内容不经过用户态
+ * 4. 开启零拷贝后，包含超过阈值的外部内存块的 writev 改用 sendmsg(MSG_ZEROCOPY)，内核直接引用用户内存，
+ *    涉及的内存块在收到错误队列中的完成通知之前一直被持有
+ */
+class OutputQueue : noncopyable
+{
+public:
+    static const size_t kBlockSize = 16 * 1024; // 拷贝数据时新分配的块的最小大小
+    static const int kMaxIovecs = 64;           // 一次 writev 最多提交的块数
+
+    OutputQueue()
+        : head_(0)
+        , readableBytes_(0)
+        , zeroCopyThreshold_(0)
+        , zeroCopyNextSeq_(0)
+        , zeroCopyCopied_(0)
+    { }
+
+    // 等待发送的总字节数，包括还没有发送的文件内容
+    size_t readableBytes() const { return readableBytes_; }
+    bool empty() const { return readableBytes_ == 0; }
+
+    void append(const char *data, size_t len);
+    // data 必须指向 holder 持有的内存，发送完之前 holder 不会释放
+    void append(const std::shared_ptr<const char> &holder, const char *data, size_t len);
+    // 接管 fd ，文件片段发送完或者队列析构时关闭
+    void appendFile(int fd, off_t offset, size_t len);
+
+    /**
+     * 从队首发送一次数据，返回发送的字节数，出错返回 -1 并设置 saveErrno
+     * 队首是文件时调用 sendfile ，否则把连续的内存块一起 writev
+     * 文件被截断或者 sendfile 出错时丢弃该文件剩下的部分
+     */
+    ssize_t writeFd(int fd, int *saveErrno);
+
+    // 外部内存块不小于 threshold 时使用 MSG_ZEROCOPY 发送，0 表示关闭，socket 需要先设置 SO_ZEROCOPY
+    void setZeroCopyThreshold(size_t threshold) { zeroCopyThreshold_ = threshold; }
+    size_t zeroCopyThreshold() const { return zeroCopyThreshold_; }
+    // 还没有收到完成通知的零拷贝发送次数
+    size_t pendingZeroCopySends() const { return pinned_.size(); }
+    // 内核没有走零拷贝而是退回拷贝的发送次数(例如发往本机的 loopback 连接)
+    uint64_t zeroCopyCopiedSends() const { return zeroCopyCopied_; }
+
+    /**
+     * 读取 socket 错误队列中的零拷贝完成通知，释放对应发送持有的内存块，返回读到的通知个数
+     * 完成通知会触发 EPOLLERR ，由 TcpConnection::handleError 在 loop 线程中调用
+     */
+    int handleZeroCopyCompletions(int fd);
+
+private:
+    struct Chunk
+    {
+        std::shared_ptr<const char> holder; // 持有内存块，文件片段时为空
+        bool external;                      // 是否是 append(holder, ...) 传入的外部内存，可以零拷贝发送
+        const char *data;                   // 待发送数据的起始位置
+        size_t len;                         // 待发送的字节数
+        size_t avail;                       // 自己分配的块尾部还可以追加的字节数，引用外部内存时为 0
+        std::shared_ptr<int> file;          // 文件片段，最后一个引用释放时关闭 fd
+        off_t offset;                       // 文件片段下一次发送的偏移
+    };
+
+    // 一次零拷贝发送，seq 是内核为该 socket 上每次 MSG_ZEROCOPY 发送分配的序号
+    struct PinnedSend
+    {
+        uint32_t seq;
+        std::vector<std::shared_ptr<const char>> holders;
+    };
+
+    // 零拷贝发送了 n 个字节，持有队首涉及的内存块直到收到完成通知
+    void pin(size_t n);
+    // 已经发送了 n 个字节，移除发送完的内存块
+    void consume(size_t n);
+    Chunk &front() { return chunks_[head_]; }
+    // 移除队首，队列清空时连同数组一起释放，空闲连接的发送队列不占用堆内存
+    void popFront();
+
+    // chunks_[head_, size) 是等待发送的部分，队列不为空时 head_ < chunks_.size()
+    std::vector<Chunk> chunks_;
+    size_t head_;
+    size_t readableBytes_;
+
+    size_t zeroCopyThreshold_;
+    uint32_t zeroCopyNextSeq_;
+    uint64_t zeroCopyCopied_;
+    // 按 seq 递增排列，连接析构时还没有收到通知的内存块随之释放，此时对端已经关闭或者连接被强制关闭
+    std::vector<PinnedSend> pinned_;
+};
+
+#endif // OUTPUT_QUEUE_H
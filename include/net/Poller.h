@@ -0,0 +1,49 @@
+#ifndef POLLER_H
+#define POLLER_H
+
+#include <vector>
+#include "../base/noncopyable.h"
+#include "../base/Timestamp.h"
+#include "../net/ChannelTable.h"
+
+class Channel;
+class EventLoop;
+
+/**
+ * IO 复用的抽象基类，EventLoop 只通过该接口操作具体的实现
+ * Epoller : epoll_wait + epoll_ctl
+ * UringPoller : io_uring 的 POLL_ADD ，注册和等待合并到一次 io_uring_enter 中
+ */
+class Poller : noncopyable
+{
+public:
+    using ChannelList = std::vector<Channel*> ;
+
+    explicit Poller(EventLoop *loop)
+        : ownerLoop_(loop)
+    {
+    }
+    virtual ~Poller() = default;
+
+    // 等待事件发生，把活跃的 channel 填到 activeChannels 中，返回事件发生的时间
+    virtual Timestamp poll(int timeoutMs, ChannelList *activeChannels) = 0;
+    virtual void updateChannel(Channel *channel) = 0;
+    virtual void removeChannel(Channel *channel) = 0;
+
+    // 判断 channel 是否注册到 poller 当中
+    bool hasChannel(Channel *channel) const;
+
+    // 创建 Poller ，内核不支持 io_uring 时退回到 Epoller
+    static Poller* newPoller(EventLoop *loop, bool useIoUring);
+
+protected:
+    static const int kNew = -1  ; // 未添加在 Poller 中
+    static const int kAdded = 1 ; // 已添加在 Poller 中
+    static const int kDeleted = 2;// 已删除在 Poller 中
+
+    ChannelTable channels_ ;  // 以 fd 为下标储存 channel 和它的注册状态(kNew/kAdded/kDeleted)
+
+    EventLoop *ownerLoop_;  // 定义Poller所属的事件循环EventLoop
+};
+
+#endif // POLLER_H
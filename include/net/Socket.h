@@ -22,7 +22,7 @@ public:
     void bindAddress(const InetAddress &localaddr);
     
     // 使sockfd为可接受连接状态
-    void listen();
+    void listen(int backlog = 1024);
     
     // 接受连接
     int accept(InetAddress *peeraddr);
@@ -34,6 +34,15 @@ public:
     void setReuseAddr(bool on);     // 设置地址复用
     void setReusePort(bool on);     // 设置端口复用
     void setKeepAlive(bool on);     // 设置长连接
+    bool setZeroCopy(bool on);      // 允许 MSG_ZEROCOPY 发送，内核不支持时返回 false
+
+    // 下面的选项设置失败时返回 false ，例如对 Unix 域 socket 设置 TCP 选项或者内核关闭了 TFO
+    bool setDeferAccept(int seconds);       // TCP_DEFER_ACCEPT ，收到数据之后才完成 accept
+    bool setFastOpen(int queueLength);      // 监听 socket 开启 TCP_FASTOPEN
+    bool setCork(bool on);                  // TCP_CORK ，攒满一个报文或者取消之后才发送
+    bool setRecvBufferSize(int bytes);      // SO_RCVBUF
+    bool setSendBufferSize(int bytes);      // SO_SNDBUF
+    bool setBusyPoll(int micros);           // SO_BUSY_POLL ，阻塞读取时先忙轮询网卡队列的微秒数，超过 net.core.busy_read 需要 CAP_NET_ADMIN
 
 private:
     const int sockfd_;
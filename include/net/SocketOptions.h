@@ -0,0 +1,38 @@
+#ifndef SOCKET_OPTIONS_H
+#define SOCKET_OPTIONS_H
+
+/**
+ * TcpServer/TcpClient 的 socket 参数，默认值和没有这个结构之前的行为相同
+ * 监听 socket 的参数在 Acceptor::listen 时设置；缓冲区大小也设置在监听 socket 上，由 accept 出来的连接继承，
+ * 并且在 listen 之前设置才能影响握手时协商的窗口扩大因子
+ * 连接参数在每个连接建立时设置，连接回调中可以通过 TcpConnection 的同名函数单独覆盖
+ */
+struct SocketOptions
+{
+    static const int kDefaultBacklog = 1024;
+
+    SocketOptions()
+        : backlog(kDefaultBacklog)
+        , deferAcceptSeconds(0)
+        , fastOpenQueueLength(0)
+        , tcpNoDelay(false)
+        , keepAlive(true)
+        , recvBufferSize(0)
+        , sendBufferSize(0)
+        , busyPollMicros(0)
+    { }
+
+    // 监听 socket
+    int backlog;                // listen 的全连接队列长度
+    int deferAcceptSeconds;     // TCP_DEFER_ACCEPT ，客户端发来数据之后监听 socket 才可读，最多等待的秒数，0 表示关闭
+    int fastOpenQueueLength;    // TCP_FASTOPEN ，等待完成的 TFO 请求队列长度，0 表示关闭
+
+    // 连接
+    bool tcpNoDelay;            // TCP_NODELAY ，关闭 Nagle 算法
+    bool keepAlive;             // SO_KEEPALIVE
+    int recvBufferSize;         // SO_RCVBUF ，0 表示使用内核默认值并保留自动调整
+    int sendBufferSize;         // SO_SNDBUF ，0 表示使用内核默认值并保留自动调整
+    int busyPollMicros;         // SO_BUSY_POLL ，没有数据时先忙轮询网卡队列的微秒数，0 表示使用 net.core.busy_read
+};
+
+#endif // SOCKET_OPTIONS_H
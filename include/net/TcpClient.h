@@ -0,0 +1,84 @@
+#ifndef TCP_CLIENT_H
+#define TCP_CLIENT_H
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+#include "../base/noncopyable.h"
+#include "../net/Callback.h"
+#include "../net/Connector.h"
+#include "../net/InetAddress.h"
+#include "../net/TcpConnection.h"
+
+class EventLoop;
+
+/**
+ * 和 TcpServer 对应的客户端，在一个 EventLoop 上维护到 serverAddr 的一条连接
+ * 连接建立之后和服务器端一样使用 TcpConnection ，回调、发送队列、背压等行为完全相同
+ * 开启 enableRetry 之后连接断开会按照 Connector 的指数退避自动重连
+ */
+class TcpClient : noncopyable
+{
+public:
+    TcpClient(EventLoop *loop,
+              const InetAddress &serverAddr,
+              const std::string &nameArg);
+    ~TcpClient();
+
+    void connect();    // 开始连接，可以在任意线程中调用
+    void disconnect(); // 关闭已经建立的连接(shutdown)，不再重连
+    void stop();       // 停止还在进行中的连接和重连，不影响已经建立的连接
+
+    // 当前连接，没有连接时返回空指针，可以在任意线程中调用
+    TcpConnectionPtr connection() const
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return connection_;
+    }
+
+    EventLoop* getLoop() const { return loop_; }
+    bool retry() const { return retry_; }
+    // 连接断开之后自动重连
+    void enableRetry() { retry_ = true; }
+
+    // 单次 connect 的超时时间和重试的退避时间，需要在 connect 之前设置
+    void setConnectTimeout(double seconds) { connector_->setConnectTimeout(seconds); }
+    void setRetryDelay(int initMs, int maxMs) { connector_->setRetryDelay(initMs, maxMs); }
+    // 缓冲区大小在 connect 之前设置，其他连接参数在连接建立时设置
+    void setSocketOptions(const SocketOptions &options)
+    {
+        socketOptions_ = options;
+        connector_->setSocketOptions(options);
+    }
+
+    const std::string& name() const { return name_; }
+
+    // 需要在 connect 之前设置
+    void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
+    void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
+    void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
+
+private:
+    // 在 loop 线程中调用，Connector 连接成功
+    void newConnection(int sockfd);
+    // 在 loop 线程中调用，连接断开
+    void removeConnection(const TcpConnectionPtr &conn);
+
+    EventLoop *loop_;
+    std::shared_ptr<Connector> connector_;
+    const std::string name_;
+    const std::shared_ptr<const std::string> namePrefix_; // 连接名字的前缀 name-ipPort
+    ConnectionCallback connectionCallback_;
+    MessageCallback messageCallback_;
+    WriteCompleteCallback writeCompleteCallback_;
+    std::atomic_bool retry_;
+    std::atomic_bool connect_;
+    SocketOptions socketOptions_;
+    uint32_t nextConnId_;                               // 只在 loop 线程中访问
+    mutable std::mutex mutex_;
+    TcpConnectionPtr connection_;                       // 由 mutex_ 保护
+};
+
+#endif // TCP_CLIENT_H
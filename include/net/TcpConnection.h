@@ -4,30 +4,52 @@
 #include <memory>
 #include <string>
 #include <atomic> 
+#include <stdint.h>
+#include <sys/types.h>
 
 #include "../base/noncopyable.h"
 #include "../net/Callback.h"
 #include "../net/Buffer.h"
+#include "../net/OutputQueue.h"
 #include "../base/Timestamp.h"
 #include "../net/InetAddress.h"
+#include "../net/Socket.h"
+#include "../net/SocketOptions.h"
+#include "../net/Channel.h"
+#include "../net/TimerId.h"
 
-class Channel;
 class EventLoop;
-class Socket;
 
 class TcpConnection : noncopyable, 
     public std::enable_shared_from_this<TcpConnection>
 {
 public:
+    /**
+     * Socket 和 Channel 直接内嵌在对象中，TcpServer 通过 allocate_shared 从每个 loop 的 slab 中分配，
+     * 建立一个连接只需要一次分配
+     * namePrefix 由同一个 TcpServer 的所有连接共享，名字只在 name() 被调用(例如需要打印日志)时才拼接
+     */
     TcpConnection(EventLoop *loop,
-                const std::string &nameArg,
+                const std::shared_ptr<const std::string> &namePrefix,
                 int sockfd,
                 const InetAddress &localAddr,
                 const InetAddress &peerAddr) ;
     ~TcpConnection() ;
 
+    // 边缘触发模式下单个连接一轮最多读写的字节数，超过后让出 loop 处理其他连接
+    static const size_t kDefaultMaxBytesPerRound = 256 * 1024 ;
+    // 开启零拷贝时默认的阈值，更小的数据锁定页面和处理完成通知的开销超过一次拷贝
+    static const size_t kDefaultZeroCopyThreshold = 32 * 1024 ;
+    // 每次读取前预留的接收空间的范围，根据最近读到的字节数在两者之间翻倍或者减半
+    static const size_t kMinReadSize = 256 ;
+    static const size_t kMaxReadSize = 64 * 1024 ;
+
     EventLoop* getLoop() const { return loop_; }
-    const std::string& name() const { return name_; }
+    // 名字的格式是 namePrefix#分片.槽位.代数 ，每次调用都会重新拼接
+    std::string name() const;
+    // TcpServer 分配的连接 ID ，带有代数，连接关闭之后不会被新连接复用
+    uint64_t id() const { return id_; }
+    void setId(uint64_t id) { id_ = id; }
     const InetAddress& localAddress() const { return localAddr_; }
     const InetAddress& peerAddress() const { return peerAddr_; }
 
@@ -37,9 +59,47 @@ public:
     // 发送数据
     void send(const std::string &buf);
     void send(Buffer *buf);
+    // 发送 holder 持有的 [data, data + len)，没有一次发送完时发送队列只引用这块内存，不拷贝
+    void send(const std::shared_ptr<const char> &holder, const char *data, size_t len);
+    /**
+     * 发送文件 fd 的 [offset, offset + len) 部分，排在之前 send 的数据之后，之后 send 的数据排在文件之后
+     * 文件内容通过 sendfile 在内核中直接发送，不经过用户态缓冲区，同样计入高水位
+     * fd 会被 dup 一份，调用之后就可以关闭
+     */
+    void sendFile(int fd, off_t offset, size_t len);
 
     // 关闭连接
     void shutdown();
+    // 强制关闭连接，不等待发送缓冲区的数据发送完
+    void forceClose();
+
+    // 暂停/恢复读取，线程安全
+    void startRead();
+    void stopRead();
+    bool isReading() const { return reading_; }
+
+    /**
+     * 读端背压，需要在 connectEstablished 之前设置，highWaterMark 为 0 表示关闭
+     * 发送队列超过 highWaterMark 时暂停读取背压源，降到 lowWaterMark 及以下时恢复
+     * 暂停超过 evictSeconds 秒还没有恢复时认为对端消费太慢，强制关闭这个连接，<= 0 表示不踢
+     */
+    void setBackpressure(size_t highWaterMark, size_t lowWaterMark, double evictSeconds = 0)
+    {
+        backpressureHigh_ = highWaterMark ;
+        backpressureLow_ = lowWaterMark ;
+        evictSeconds_ = evictSeconds ;
+    }
+    /**
+     * 背压时暂停读取的连接，默认是自己
+     * 代理时把下游连接的背压源设置为上游连接，下游发送不出去时停止从上游读取，可以在不同的 loop 上
+     * 一个背压源只应该对应一个下游连接，需要在本连接所在的 loop 线程中或者 connectEstablished 之前设置
+     */
+    void setBackpressureSource(const TcpConnectionPtr &source) { backpressureSource_ = source ; }
+    // 当前是否因为发送队列积压暂停了背压源的读取
+    bool backpressured() const { return backpressured_; }
+
+    // 最近一次收到数据的时间，用于空闲连接检测
+    Timestamp lastActiveTime() const { return lastActiveTime_; }
 
     // 保存用户自定义的回调函数
     void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb ; }
@@ -50,6 +110,38 @@ public:
     // 这个回调函数时 Server 类中设置的
     void setCloseCallback(const CloseCallback &cb) { closeCallback_ = cb ; }
 
+    /**
+     * 使用边缘触发模式，需要在 connectEstablished 之前设置
+     * EPOLLOUT 一直保持注册，不再随着发送缓冲区的空满反复 epoll_ctl ，读写都会一直进行到 EAGAIN
+     * maxBytesPerRound 保证一个数据量很大的连接不会一直占用 loop
+     */
+    void setEdgeTriggered(bool on, size_t maxBytesPerRound = kDefaultMaxBytesPerRound) 
+    { 
+        edgeTriggered_ = on ; 
+        maxBytesPerRound_ = maxBytesPerRound ; 
+    }
+
+    /**
+     * 不小于 threshold 字节的 send(holder, data, len) 使用 MSG_ZEROCOPY 发送，0 表示关闭，需要在 connectEstablished 之前设置
+     * 内核直接引用 holder 的内存，holder 一直持有到错误队列返回完成通知，通知在 loop 线程中处理
+     * 发往本机的连接内核仍然会拷贝，反而多了通知的开销
+     */
+    void setZeroCopy(size_t threshold);
+
+    // 设置 SocketOptions 中的连接参数(TCP_NODELAY 、SO_KEEPALIVE)，和内核默认值相同的项不调用 setsockopt
+    void setSocketOptions(const SocketOptions &options);
+    // 单独覆盖这个连接的 socket 参数，可以在任意线程中调用
+    void setTcpNoDelay(bool on) { socket_.setTcpNoDelay(on); }
+    void setKeepAlive(bool on) { socket_.setKeepAlive(on); }
+    bool setRecvBufferSize(int bytes) { return socket_.setRecvBufferSize(bytes); }
+    bool setSendBufferSize(int bytes) { return socket_.setSendBufferSize(bytes); }
+    /**
+     * TCP_CORK ，开启之后小块数据攒满一个报文才发出，关闭时立即发出剩余的部分
+     * 在 loop 线程中和 send 按调用顺序执行，例如 setCork(true); send(头部); sendFile(文件); setCork(false);
+     * 头部不会单独占用一个报文
+     */
+    void setCork(bool on);
+
     // TcpServer会调用
     void connectEstablished(); // 连接建立
     void connectDestroyed();   // 连接销毁
@@ -71,18 +163,49 @@ private :
     void handleWrite();
     void handleClose();
     void handleError();
+    void handleReadEdgeTriggered(Timestamp receiveTime);
+    void handleWriteEdgeTriggered();
+    // io_uring 的 multishot recv 在 poll 返回之前把数据交给这里，只拷贝到接收缓冲区，不调用用户回调
+    void handleRecvCompletion(int res, const char *data);
+    // 由 Poller 完成读取时的读事件，把已经收到的数据交给上层，再处理对端关闭和错误
+    void handleCompletedReads(Timestamp receiveTime);
+    // 发送缓冲区中是否还有等待发送的数据
+    bool outputPending() const;
+    // 读取之前从 loop 的 BufferPool 取出接收缓冲区，并预留 readSizeHint_ 的可写空间
+    void acquireInputBuffer();
+    // 接收缓冲区中的数据已经全部被取走时归还给 BufferPool
+    void releaseInputBuffer();
+    // 连续读满时预留空间翻倍，连续两次不到一半时减半
+    void updateReadSizeHint(size_t n);
 
     void sendInLoop(const void* message, size_t len);
     void sendInLoop(const std::string& message);
+    // holder 为空时没有发送完的数据拷贝到发送队列中，否则只引用 holder 持有的内存
+    void sendInLoop(const std::shared_ptr<const char> &holder, const char *data, size_t len);
+    void sendFileInLoop(int fd, off_t offset, size_t len);
+    // 新追加了 len 字节到发送队列，检查高水位，之前没有待发送数据时直接发送一次
+    void writeQueuedInLoop(size_t oldLen, size_t len);
     void shutdownInLoop();
+    void forceCloseInLoop();
+    void startReadInLoop();
+    void stopReadInLoop();
+    void setCorkInLoop(bool on);
+    // 发送队列长度变化之后检查是否需要暂停或者恢复背压源的读取
+    void checkBackpressure();
+    void resumeBackpressureSource();
+    // 暂停 evictSeconds_ 之后仍然积压时关闭连接
+    static void evictIfStalled(const std::weak_ptr<TcpConnection> &weakConn);
 
     EventLoop *loop_;           // 属于哪个subLoop（如果是单线程则为mainLoop）
-    const std::string name_;
+    const std::shared_ptr<const std::string> namePrefix_;
+    uint64_t id_;
     std::atomic_int state_;     // 连接状态
-    bool reading_;
+    bool reading_;              // 是否在读取，stopRead 之后为 false
+    bool edgeTriggered_;        // 是否使用边缘触发模式
+    size_t maxBytesPerRound_;   // 边缘触发模式下一轮最多读写的字节数
 
-    std::unique_ptr<Socket> socket_;
-    std::unique_ptr<Channel> channel_;
+    Socket socket_;
+    Channel channel_;
 
     const InetAddress localAddr_;   // 本服务器地址
     const InetAddress peerAddr_;    // 对端地址
@@ -97,9 +220,22 @@ private :
     CloseCallback closeCallback_;                   // 客户端关闭连接的回调
     HighWaterMarkCallback highWaterMarkCallback_;   // 超出水位时的回调
     size_t highWaterMark_;
-
-    Buffer inputBuffer_;    // 读取数据的缓冲区
-    Buffer outputBuffer_;   // 发送数据的缓冲区
+    Timestamp lastActiveTime_;  // 最近一次收到数据的时间
+
+    size_t backpressureHigh_;                       // 发送队列超过这个长度时暂停读取，0 表示关闭
+    size_t backpressureLow_;                        // 发送队列降到这个长度及以下时恢复读取
+    double evictSeconds_;                           // 持续积压超过这个时间强制关闭，<= 0 表示不踢
+    std::weak_ptr<TcpConnection> backpressureSource_; // 背压时暂停读取的连接，为空表示自己
+    bool backpressured_;                            // 是否暂停了背压源的读取
+    TimerId evictTimer_;                            // 积压超时的定时器
+
+    std::unique_ptr<Buffer> inputBuffer_;   // 读取数据的缓冲区，只在有未处理的数据时持有，空闲连接不占用
+    size_t readSizeHint_;                   // 下一次读取预留的空间
+    int smallReads_;                        // 连续读到的数据不足 readSizeHint_ 一半的次数
+    size_t completedBytes_;                 // Poller 已经收到、还没有交给上层的字节数
+    bool completedEof_;                     // Poller 收到了对端关闭
+    int completedErrno_;                    // Poller 接收时的错误
+    OutputQueue outputQueue_;   // 发送队列，数据块和文件片段按顺序用 writev/sendfile 发送
 } ;
 
 
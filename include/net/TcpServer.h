@@ -6,14 +6,19 @@
 #include <memory>
 #include <unordered_map>
 #include <atomic>
+#include <vector>
+#include <mutex>
 
 #include "../base/noncopyable.h"
+#include "../base/Slab.h"
 #include "../net/EventLoop.h"
 #include "../net/EventLoopThreadPool.h"
 #include "../net/Acceptor.h"
 #include "../net/InetAddress.h"
 #include "../net/Callback.h"
 #include "../net/TcpConnection.h"
+#include "../net/TimingWheel.h"
+#include "../net/ConnectionRegistry.h"
 
 class TcpServer : noncopyable
 {
@@ -26,6 +31,22 @@ public:
         kReusePort,
     };
 
+    // Acceptor 的统计计数，多个 loop 各自监听时是所有 Acceptor 的总和
+    struct AcceptStats
+    {
+        int64_t accepted;   // 成功建立的连接数
+        int64_t shed;       // 超过连接数上限或 fd 耗尽时被直接关闭的连接数
+        int64_t emfile;     // accept 返回 EMFILE/ENFILE 的次数
+    };
+
+    // 新连接的接收方式
+    enum AcceptMode
+    {
+        kSingleAcceptor,    // mainLoop 上一个 Acceptor ，接收之后轮询分发给 subLoop
+        kReusePortPerLoop,  // 每个 loop 各自 bind 一个 SO_REUSEPORT 监听 socket ，由内核把连接分散到各个 loop
+        kExclusiveShared,   // 所有 loop 共享一个监听 socket ，以 EPOLLEXCLUSIVE 注册，每个新连接只唤醒一个 loop
+    };
+
     TcpServer(EventLoop *loop,
                 const InetAddress &ListenAddr,
                 const std::string &nameArg,
@@ -37,10 +58,94 @@ public:
     void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
     void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
     void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
+    void setHighWaterMarkCallback(const HighWaterMarkCallback &cb, size_t highWaterMark)
+    {
+        highWaterMarkCallback_ = cb;
+        highWaterMark_ = highWaterMark;
+    }
 
      // 设置底层subLoop的个数
     void setThreadNum(int numThreads);
 
+    // 设置 subLoop 线程绑定的 CPU 列表，需要在 start 之前设置
+    // 配合 kReusePortPerLoop 使用时连接对象和缓冲区都在绑定的 loop 线程中创建，分配在本地 NUMA 节点上
+    void setCpuAffinity(const std::vector<int> &cpus) { threadPool_->setCpuAffinity(cpus); }
+
+    // 设置新连接选择 subLoop 的策略，需要在 start 之前设置
+    // 只对 kSingleAcceptor 模式有效，每个 loop 各自监听时由内核决定连接落在哪个 loop
+    void setLoadBalancePolicy(EventLoopThreadPool::LoadBalancePolicy policy) { threadPool_->setLoadBalancePolicy(policy); }
+
+    // 设置空闲连接超时时间(秒)，超过该时间没有收到数据的连接会被强制关闭，<= 0 表示不检测，需要在 start 之前设置
+    void setIdleTimeout(int seconds) { idleTimeout_ = seconds; }
+
+    // 新连接使用边缘触发模式，maxBytesPerRound 是单个连接一轮最多读写的字节数，需要在 start 之前设置
+    void setEdgeTriggered(bool on, size_t maxBytesPerRound = TcpConnection::kDefaultMaxBytesPerRound)
+    {
+        edgeTriggered_ = on;
+        maxBytesPerRound_ = maxBytesPerRound;
+    }
+
+    // 新连接不小于 threshold 字节的 send(holder, data, len) 使用 MSG_ZEROCOPY 发送，0 表示关闭，需要在 start 之前设置
+    void setZeroCopy(size_t threshold = TcpConnection::kDefaultZeroCopyThreshold) { zeroCopyThreshold_ = threshold; }
+
+    /**
+     * 新连接的读端背压，需要在 start 之前设置，highWaterMark 为 0 表示关闭
+     * 连接的发送队列超过 highWaterMark 时暂停读取，降到 lowWaterMark 及以下时恢复
+     * 持续积压超过 evictSeconds 秒时强制关闭，<= 0 表示不踢
+     * 代理场景可以在连接回调中用 TcpConnection::setBackpressureSource 改为暂停上游连接
+     */
+    void setBackpressure(size_t highWaterMark, size_t lowWaterMark, double evictSeconds = 0)
+    {
+        backpressureHigh_ = highWaterMark;
+        backpressureLow_ = lowWaterMark;
+        evictSeconds_ = evictSeconds;
+    }
+
+    /**
+     * 监听 socket 和新连接的 socket 参数，需要在 start 之前设置
+     * 单个连接可以在连接回调中通过 TcpConnection::setTcpNoDelay 等函数覆盖
+     */
+    void setSocketOptions(const SocketOptions &options) { socketOptions_ = options; }
+    const SocketOptions& socketOptions() const { return socketOptions_; }
+
+    /**
+     * 所有 loop 开启忙轮询，见 EventLoop::setBusyPoll ，需要在 start 之前设置，0 表示关闭
+     * 用 CPU 换延迟，请求到达空闲 loop 时不再需要调度器唤醒线程；配合 SocketOptions::busyPollMicros 使用
+     */
+    void setBusyPoll(int spinMicros) { busyPollMicros_ = spinMicros; }
+
+    // 所有 loop 每轮的调度预算，见 EventLoop::setRoundBudget ，需要在 start 之前设置
+    void setRoundBudget(int maxChannels, int maxFunctors, int maxMicros = 0)
+    {
+        roundMaxChannels_ = maxChannels;
+        roundMaxFunctors_ = maxFunctors;
+        roundBudgetMicros_ = maxMicros;
+    }
+
+    // 设置新连接的接收方式，需要在 start 之前设置
+    // 后两种模式下新连接在接收它的 loop 中直接建立，不再经过 mainLoop 转发
+    // Unix 域地址不能在多个 socket 上 bind ，kReusePortPerLoop 会退回 kSingleAcceptor
+    void setAcceptMode(AcceptMode mode) { acceptMode_ = mode; }
+
+    // 最大连接数，超过之后新连接被接收后立即关闭，<= 0 表示不限制
+    // 多个 loop 同时接收连接时是近似限制，可能会短暂超过几个
+    void setMaxConnections(int n) { maxConnections_ = n; }
+
+    // 每次监听 socket 可读时最多接收的连接数，需要在 start 之前设置
+    void setMaxAcceptsPerRound(int n) { maxAcceptsPerRound_ = n; }
+
+    // 当前连接数
+    int numConnections() const { return numConnections_.load(); }
+
+    // 按 TcpConnection::id() 查找连接，连接已经关闭时返回空指针，可以在任意线程中调用
+    TcpConnectionPtr findConnection(uint64_t id);
+
+    // 获取 Acceptor 的统计计数，start 之后可以在任意线程中调用
+    AcceptStats acceptStats() const;
+
+    // 所有 loop 的运行统计快照，见 EventLoopThreadPool::metrics ，start 之后可以在任意线程中调用
+    std::vector<LoopMetrics::Snapshot> loopMetrics() const { return threadPool_->metrics(); }
+
     // 开启服务器监听
     void start();
     
@@ -52,26 +157,77 @@ public:
 
 private : 
     void newConnection(int sockfd, const InetAddress &peerAddr);
+    // 在 ioLoop 上为 sockfd 建立 TcpConnection
+    void newConnectionInLoop(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr);
+    // 为线程池中的每个 loop 创建各自的 Acceptor
+    void startLoopAcceptors();
+    // 新连接准入检查，是否还没有达到最大连接数
+    bool admitConnection() const;
+    // 在连接所在的 loop 中调用，直接从该 loop 的分片中移除，不再经过 mainLoop
     void removeConnection(const TcpConnectionPtr &conn);
-    void removeConnectionInLoop(const TcpConnectionPtr &conn);
 
-    using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr> ;
-    
+    /**
+     * 每个 loop 一个连接分片，连接的建立、移除和销毁都在所属 loop 的分片上完成
+     * 只有 findConnection 和 TcpServer 析构时会从其他线程访问，mutex 正常情况下没有竞争
+     */
+    struct ConnectionShard
+    {
+        explicit ConnectionShard(uint32_t index)
+            : registry(index)
+            , slab(std::make_shared<FixedSizeSlab>())
+        { }
+
+        std::mutex mutex;
+        ConnectionRegistry registry;
+        std::shared_ptr<FixedSizeSlab> slab;    // 该 loop 上 TcpConnection 的内存
+    };
+
+    using TimingWheelMap = std::unordered_map<EventLoop*, std::shared_ptr<TimingWheel>> ;
+    using AcceptorList = std::vector<std::unique_ptr<Acceptor>> ;
+    using ShardList = std::vector<std::unique_ptr<ConnectionShard>> ;
+    using ShardMap = std::unordered_map<EventLoop*, ConnectionShard*> ;
+
     EventLoop *loop_;                                 // 用户定义的baseLoop
+    const InetAddress listenAddr_;                    // 监听地址
     const std::string ipPort_;                        // 传入的IP地址和端口号
     const std::string name_;                          // TcpServer名字
+    const std::shared_ptr<const std::string> namePrefix_; // 连接名字的前缀 name-ipPort ，所有连接共享
     std::unique_ptr<Acceptor> acceptor_;              // Acceptor对象负责监视
+    AcceptMode acceptMode_;                           // 新连接的接收方式
+    AcceptorList loopAcceptors_;                      // 每个 loop 各自的 Acceptor ，与 getAllLoops() 一一对应
+    // 连接分片声明在线程池之前，线程池析构、各个 loop 线程退出之后才析构，析构期间关闭的连接仍然可以访问分片
+    ShardList shards_;                                // 下标是连接 ID 中的分片编号，和 getAllLoops 的顺序一致，start 之后只读
+    ShardMap loopShards_;                             // loop 到分片的映射，start 之后只读
     std::shared_ptr<EventLoopThreadPool> threadPool_; // 线程池
 
     ConnectionCallback  connectionCallback_;        // 有新连接时的回调函数
     MessageCallback messageCallback_;               // 有读写消息时的回调函数
     WriteCompleteCallback writeCompleteCallback_;   // 消息发送完成以后的回调函数
+    HighWaterMarkCallback highWaterMarkCallback_;   // 发送队列超过高水位时的回调函数
+    size_t highWaterMark_;
 
     ThreadInitCallback threadInitCallback_;         // loop线程初始化的回调函数
     std::atomic_int started_;                       // TcpServer 是否已经启动了
 
-    int nextConnId_;                                // subloop_ 连接索引
-    ConnectionMap connections_;                     // 保存所有 fd_name 对应的 TcpConnection 的连接
+    std::atomic_int numConnections_;                // 当前连接数
+    std::atomic_int maxConnections_;                // 最大连接数，<= 0 表示不限制
+    int maxAcceptsPerRound_;                        // 每次可读事件最多接收的连接数
+
+    int idleTimeout_;                               // 空闲连接超时时间(秒)
+    TimingWheelMap timingWheels_;                   // 每个 loop 一个时间轮，踢掉空闲连接
+
+    bool edgeTriggered_;                            // 新连接是否使用边缘触发模式
+    size_t maxBytesPerRound_;                       // 边缘触发模式下单个连接一轮最多读写的字节数
+    size_t zeroCopyThreshold_;                      // 新连接零拷贝发送的阈值，0 表示关闭
+    SocketOptions socketOptions_;                   // 监听 socket 和新连接的 socket 参数
+    int busyPollMicros_;                            // loop 忙轮询的时间，0 表示关闭
+    int roundMaxChannels_;                          // loop 每轮的调度预算，0 表示不限制
+    int roundMaxFunctors_;
+    int roundBudgetMicros_;
+
+    size_t backpressureHigh_;                       // 新连接暂停读取的发送队列长度，0 表示关闭背压
+    size_t backpressureLow_;                        // 新连接恢复读取的发送队列长度
+    double evictSeconds_;                           // 持续积压超过这个时间强制关闭
 } ; 
 
 #endif
\ No newline at end of file
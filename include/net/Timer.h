@@ -0,0 +1,49 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <atomic>
+#include <functional>
+#include "../base/noncopyable.h"
+#include "../base/Timestamp.h"
+
+/**
+ * Timer 定时器，保存到期时间、回调函数以及重复间隔
+ * 由 TimerQueue 负责管理其生命周期，用户只能拿到 TimerId
+ */
+class Timer : noncopyable
+{
+public:
+    using TimerCallback = std::function<void()> ;
+
+    Timer(TimerCallback cb, Timestamp when, double interval)
+        : callback_(std::move(cb)),
+          expiration_(when),
+          interval_(interval),
+          repeat_(interval > 0.0),
+          sequence_(++numCreated_)
+    {
+    }
+
+    // 定时器到期，执行用户设置的回调函数
+    void run() const { callback_(); }
+
+    Timestamp expiration() const { return expiration_; }
+    bool repeat() const { return repeat_; }
+    int64_t sequence() const { return sequence_; }
+
+    // 重复定时器在 now 的基础上计算下一次到期时间
+    void restart(Timestamp now);
+
+    static int64_t numCreated() { return numCreated_; }
+
+private:
+    const TimerCallback callback_;  // 定时器到期执行的回调函数
+    Timestamp expiration_;          // 下一次到期时间
+    const double interval_;         // 重复间隔，单位秒，<= 0 表示一次性定时器
+    const bool repeat_;             // 是否是重复定时器
+    const int64_t sequence_;        // 全局唯一序号，区分地址被复用的 Timer 对象
+
+    static std::atomic<int64_t> numCreated_;
+};
+
+#endif // TIMER_H
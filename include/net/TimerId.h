@@ -0,0 +1,34 @@
+#ifndef TIMER_ID_H
+#define TIMER_ID_H
+
+#include <stdint.h>
+
+class Timer;
+
+/**
+ * 用户持有的定时器句柄，只用于 EventLoop::cancel 取消定时器
+ * sequence_ 用来区分先后在同一地址上创建的不同 Timer
+ */
+class TimerId
+{
+public:
+    TimerId()
+        : timer_(nullptr),
+          sequence_(0)
+    {
+    }
+
+    TimerId(Timer *timer, int64_t seq)
+        : timer_(timer),
+          sequence_(seq)
+    {
+    }
+
+    friend class TimerQueue;
+
+private:
+    Timer *timer_;
+    int64_t sequence_;
+};
+
+#endif // TIMER_ID_H
@@ -0,0 +1,66 @@
+#ifndef TIMER_QUEUE_H
+#define TIMER_QUEUE_H
+
+#include <set>
+#include <vector>
+#include <utility>
+#include <functional>
+
+#include "../base/noncopyable.h"
+#include "../base/Timestamp.h"
+#include "../net/Channel.h"
+#include "../net/TimerId.h"
+
+class EventLoop;
+class Timer;
+
+/**
+ * 基于 timerfd 的定时器队列，timerfd 作为一个普通的 Channel 注册到所属 EventLoop 的 Epoller 上
+ * 所有定时器按到期时间保存在 std::set 中(红黑树)，插入和取消都是 O(logn)
+ * timerfd 总是设置为最早到期的定时器时间，可读时一次性取出所有已到期的定时器批量执行
+ */
+class TimerQueue : noncopyable
+{
+public:
+    using TimerCallback = std::function<void()> ;
+
+    explicit TimerQueue(EventLoop *loop);
+    ~TimerQueue();
+
+    // 线程安全，可以在其他线程调用，实际的插入在 loop 所在线程完成
+    TimerId addTimer(TimerCallback cb, Timestamp when, double interval);
+    void cancel(TimerId timerId);
+
+private:
+    // 以 (到期时间, Timer地址) 作为 key，同一时间到期的不同定时器也能区分
+    using Entry = std::pair<Timestamp, Timer*> ;
+    using TimerList = std::set<Entry> ;
+    // 以 (Timer地址, 序号) 作为 key，用于 cancel 时查找定时器
+    using ActiveTimer = std::pair<Timer*, int64_t> ;
+    using ActiveTimerSet = std::set<ActiveTimer> ;
+
+    void addTimerInLoop(Timer *timer);
+    void cancelInLoop(TimerId timerId);
+
+    // timerfd 可读时的回调
+    void handleRead();
+
+    // 移除并返回所有已到期的定时器
+    std::vector<Entry> getExpired(Timestamp now);
+    // 重复定时器重新插入，一次性定时器直接删除
+    void reset(const std::vector<Entry> &expired, Timestamp now);
+
+    // 插入定时器，返回最早到期时间是否发生了变化
+    bool insert(Timer *timer);
+
+    EventLoop *loop_;
+    const int timerfd_;
+    Channel timerfdChannel_;
+    TimerList timers_;              // 按到期时间排序的定时器
+
+    ActiveTimerSet activeTimers_;   // 与 timers_ 保存相同的定时器，按地址排序
+    bool callingExpiredTimers_;     // 是否正在执行到期定时器的回调
+    ActiveTimerSet cancelingTimers_;// 在回调中被取消的重复定时器，不再重新插入
+};
+
+#endif // TIMER_QUEUE_H
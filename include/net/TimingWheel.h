@@ -0,0 +1,52 @@
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <memory>
+#include <vector>
+
+#include "../base/noncopyable.h"
+#include "../base/Timestamp.h"
+#include "../net/Callback.h"
+#include "../net/TimerId.h"
+
+class EventLoop;
+
+/**
+ * 时间轮，用于踢掉空闲连接，每个 subLoop 一个，只在所属 loop 线程中访问
+ * 时间轮每秒转动一格，共 idleSeconds + 1 个格子，新连接放到 idleSeconds 秒之后的格子中
+ *
+ * 连接有数据到来时只需要更新 TcpConnection::lastActiveTime_ ，不需要移动连接所在的格子(O(1)，没有任何容器操作)
+ * 指针转到某个格子时再检查其中的连接：真正超时的强制关闭，否则按照剩余时间重新放入对应的格子
+ */
+class TimingWheel : noncopyable,
+    public std::enable_shared_from_this<TimingWheel>
+{
+public:
+    TimingWheel(EventLoop *loop, int idleSeconds);
+    ~TimingWheel();
+
+    // 在 loop 上注册每秒一次的定时器，开始转动时间轮
+    void start();
+
+    // 线程安全，新连接加入时间轮
+    void add(const TcpConnectionPtr &conn);
+
+private:
+    using WeakTcpConnectionPtr = std::weak_ptr<TcpConnection> ;
+    using Bucket = std::vector<WeakTcpConnectionPtr> ;
+    using BucketList = std::vector<Bucket> ;
+
+    // 定时器只持有时间轮的弱引用，避免 TcpServer 析构之后定时器仍然访问时间轮
+    static void onTimer(const std::weak_ptr<TimingWheel> &wheel);
+
+    void addInLoop(const WeakTcpConnectionPtr &conn);
+    void tick();
+
+    EventLoop *loop_;
+    const int idleSeconds_;     // 空闲超时时间，单位秒
+    BucketList buckets_;        // 时间轮的格子
+    size_t cursor_;             // 当前指针指向的格子
+    TimerId timerId_;           // 驱动时间轮转动的定时器
+};
+
+#endif // TIMING_WHEEL_H
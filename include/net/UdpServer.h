@@ -0,0 +1,74 @@
+#ifndef UDP_SERVER_H
+#define UDP_SERVER_H
+
+#include <functional>
+#include <string>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+
+#include "../base/noncopyable.h"
+#include "../net/EventLoop.h"
+#include "../net/EventLoopThreadPool.h"
+#include "../net/InetAddress.h"
+#include "../net/UdpSocket.h"
+
+/**
+ * UDP 服务器，每个 loop 各自 bind 一个 SO_REUSEPORT 的 UdpSocket ，由内核按四元组哈希把数据报分到各个 loop
+ * 回调在收到数据报的 loop 中执行，回复时直接调用回调参数中 socket 的 sendTo ，和接收在同一个 loop 中批量发送
+ * Unix 域地址一个路径只能 bind 一次，只在第一个 loop 上创建一个 socket
+ */
+class UdpServer : noncopyable
+{
+public:
+    using ThreadInitCallback = std::function<void(EventLoop*)>;
+
+    // 所有 UdpSocket 统计计数的总和
+    struct Stats
+    {
+        int64_t received;   // 收到的数据报个数
+        int64_t sent;       // 发送成功的数据报个数
+        int64_t dropped;    // 被截断或者发送时丢弃的数据报个数
+    };
+
+    UdpServer(EventLoop *loop, const InetAddress &listenAddr, const std::string &nameArg);
+    ~UdpServer();
+
+    // 需要在 start 之前设置
+    void setThreadInitCallback(const ThreadInitCallback &cb) { threadInitCallback_ = cb; }
+    void setMessageCallback(const UdpSocket::MessageCallback &cb) { messageCallback_ = cb; }
+    void setThreadNum(int numThreads) { threadPool_->setThreadNum(numThreads); }
+    void setBatchSize(int batchSize, size_t maxDatagramSize = UdpSocket::kDefaultMaxDatagramSize)
+    {
+        batchSize_ = batchSize;
+        maxDatagramSize_ = maxDatagramSize;
+    }
+    // 回复的数据报按 segmentSize 合并成 GSO 发送，0 表示关闭
+    void setGsoSegmentSize(uint16_t segmentSize) { gsoSegmentSize_ = segmentSize; }
+
+    void start();
+
+    // start 之后可以在任意线程中调用
+    Stats stats() const;
+
+    EventLoop* getLoop() const { return loop_; }
+    const std::string& name() const { return name_; }
+
+private:
+    using SocketList = std::vector<std::shared_ptr<UdpSocket>>;
+
+    EventLoop *loop_;
+    const InetAddress listenAddr_;
+    const std::string name_;
+    std::shared_ptr<EventLoopThreadPool> threadPool_;
+    SocketList sockets_;                      // 与 getAllLoops() 一一对应，start 之后只读
+    UdpSocket::MessageCallback messageCallback_;
+    ThreadInitCallback threadInitCallback_;
+    int batchSize_;
+    size_t maxDatagramSize_;
+    uint16_t gsoSegmentSize_;
+    std::atomic_int started_;
+};
+
+#endif // UDP_SERVER_H
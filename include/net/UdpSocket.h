@@ -0,0 +1,125 @@
+#ifndef UDP_SOCKET_H
+#define UDP_SOCKET_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "../base/noncopyable.h"
+#include "../base/Timestamp.h"
+#include "../net/InetAddress.h"
+#include "../net/Socket.h"
+#include "../net/Channel.h"
+
+class EventLoop;
+
+// recvmmsg 收到的一个数据报，data 指向 UdpSocket 预先分配的接收区，只在回调期间有效
+struct Datagram
+{
+    const char *data;
+    size_t len;
+    InetAddress peer;
+};
+
+/**
+ * 绑定在一个 EventLoop 上的数据报 socket ，bindAddr 可以是 IPv4 、IPv6 或者 Unix 域地址
+ * 1. 可读时用 recvmmsg 一次收取一批数据报到预先分配的接收区，整批交给 MessageCallback ，不再每个数据报一次系统调用
+ * 2. sendTo 把数据报拷贝到发送队列，同一轮事件处理中的所有数据报在 queueInLoop 的回调中用 sendmmsg 一起发送
+ * 3. 开启 GSO 后，发往同一个对端、长度都等于分段大小(最后一个可以更短)的连续数据报合并成一个 UDP_SEGMENT 发送
+ * 4. 发送缓冲区满时等待可写事件再继续，发送队列超过 kMaxPendingBytes 时丢弃新的数据报
+ * 发送回调会持有 weak_ptr ，UdpSocket 需要由 shared_ptr 管理，并且在所属 loop 线程中析构
+ */
+class UdpSocket : noncopyable,
+    public std::enable_shared_from_this<UdpSocket>
+{
+public:
+    // datagrams 是本批收到的 count 个数据报
+    using MessageCallback = std::function<void(UdpSocket *socket, const Datagram *datagrams, size_t count, Timestamp receiveTime)>;
+
+    static const int kDefaultBatchSize = 64;                // 一次 recvmmsg 最多收取的数据报个数
+    static const size_t kDefaultMaxDatagramSize = 2048;     // 接收区中每个数据报的大小，更长的数据报被截断后丢弃
+    static const int kMaxBatchesPerRound = 8;               // 每次可读事件最多调用 recvmmsg 的次数，避免一直占用 loop
+    static const size_t kMaxPendingBytes = 4 * 1024 * 1024; // 发送队列的上限
+    static const int kMaxGsoSegments = 64;                  // 内核限制的一次 GSO 发送最多的分段数
+
+    UdpSocket(EventLoop *loop, const InetAddress &bindAddr, bool reuseport = false);
+    ~UdpSocket();
+
+    void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
+
+    // 需要在 start 之前设置
+    void setBatchSize(int batchSize, size_t maxDatagramSize = kDefaultMaxDatagramSize);
+    // 发送时按 segmentSize 合并数据报，0 表示关闭，内核不支持 UDP_SEGMENT 时返回 false
+    bool setGsoSegmentSize(uint16_t segmentSize);
+
+    // 在 loop 中开始接收数据报，可以在任意线程中调用
+    void start();
+    // 停止接收，必须在 loop 线程中调用
+    void stop();
+
+    // 发送一个数据报，可以在任意线程中调用
+    void sendTo(const char *data, size_t len, const InetAddress &peer);
+    void sendTo(const std::string &message, const InetAddress &peer) { sendTo(message.data(), message.size(), peer); }
+
+    EventLoop* getLoop() const { return loop_; }
+    int fd() const { return socket_.fd(); }
+
+    // 统计计数，可以在其他线程中读取
+    int64_t receivedCount() const { return receivedCount_.load(std::memory_order_relaxed); } // 收到的数据报个数
+    int64_t sentCount() const { return sentCount_.load(std::memory_order_relaxed); }         // 发送成功的数据报个数
+    int64_t droppedCount() const { return droppedCount_.load(std::memory_order_relaxed); }   // 接收时被截断或者发送时丢弃的数据报个数
+
+private:
+    // 发送队列中的一个数据报，内容在 pendingData_[offset, offset + len)
+    struct Pending
+    {
+        size_t offset;
+        size_t len;
+        InetAddress peer;
+    };
+
+    void handleRead(Timestamp receiveTime);
+    void handleWrite();
+    void sendInLoop(const char *data, size_t len, const InetAddress &peer);
+    void flush();
+    // 从 pendingHead_ 开始合并最多 kMaxGsoSegments 个可以一起 GSO 发送的数据报，返回合并的个数
+    size_t gsoRun(size_t first) const;
+    static void flushAfterEvents(const std::weak_ptr<UdpSocket> &weakSocket);
+    // channel 注册过时从 Poller 中移除
+    void unregister();
+
+    EventLoop *loop_;
+    Socket socket_;
+    Channel channel_;
+    MessageCallback messageCallback_;
+
+    int batchSize_;
+    size_t maxDatagramSize_;
+    std::vector<char> recvData_;            // batchSize_ * maxDatagramSize_ 的接收区
+    std::vector<mmsghdr> recvMsgs_;
+    std::vector<iovec> recvIovecs_;
+    std::vector<sockaddr_storage> recvAddrs_;
+    std::vector<Datagram> datagrams_;       // 交给回调的本批数据报
+
+    uint16_t gsoSegmentSize_;
+    std::string pendingData_;
+    std::vector<Pending> pending_;
+    size_t pendingHead_;                    // pending_[pendingHead_, size) 还没有发送
+    bool flushScheduled_;                   // 本轮是否已经排入了 flush
+    bool registered_;                       // channel 是否已经注册到 Poller ，只由 loop 线程访问
+    std::vector<mmsghdr> sendMsgs_;
+    std::vector<iovec> sendIovecs_;
+    std::vector<size_t> sendRuns_;          // 每个 mmsghdr 包含的数据报个数
+    std::vector<char> sendControl_;         // 每个 mmsghdr 的 UDP_SEGMENT 控制消息
+
+    std::atomic<int64_t> receivedCount_;
+    std::atomic<int64_t> sentCount_;
+    std::atomic<int64_t> droppedCount_;
+};
+
+#endif // UDP_SOCKET_H
@@ -0,0 +1,139 @@
+#ifndef URING_POLLER_H
+#define URING_POLLER_H
+
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <stdint.h>
+#include <linux/io_uring.h>
+#include "../base/noncopyable.h"
+#include "../net/Channel.h"
+#include "../net/Poller.h"
+
+/**
+ * 基于 io_uring 的 Poller 实现，和 Epoller 一样以就绪事件的方式通知 Channel ，可以直接替换
+ *
+ * 1. 每个 Channel 对应一个 IORING_OP_POLL_ADD 请求，注册、修改、删除都只是往提交队列(SQ)里写 SQE，
+ *    和等待事件合并在同一次 io_uring_enter 中提交，不再需要单独的 epoll_ctl 系统调用
+ * 2. 水平触发的 Channel 使用单次 poll ，事件返回并处理完之后在下一次 poll 时重新提交，仍然就绪会立即再次返回
+ * 3. 边缘触发的 Channel 使用 multishot poll(IORING_POLL_ADD_MULTI，5.13 及以上)，提交一次之后每次状态变化都会返回一个 CQE ，
+ *    构造时实际提交一次 multishot poll 检测内核是否支持，不支持时和水平触发一样使用单次 poll
+ * 4. user_data 中保存 fd 、请求类型和注册的版本号，而不是 Channel 指针，版本号由整个 Poller 递增分配，fd 被关闭复用之后也不会重复，
+ *    Channel 被移除之后内核才返回的 CQE 会因为版本号对不上被直接丢弃，不会访问已经析构的 Channel
+ * 5. 读模式为 kReadAccept 的 Channel(Acceptor)使用 multishot accept ，一个请求持续返回新连接的 fd ，不再每个连接一次 accept4
+ * 6. 读模式为 kReadRecv 的 Channel(TcpConnection)使用 multishot recv ，数据由内核写入 Poller 提供的缓冲区(IORING_OP_PROVIDE_BUFFERS)，
+ *    reap 时交给 Channel 的 CompletionCallback 拷贝到连接的接收缓冲区，随后把缓冲区重新提供给内核，不再每次可读一次 readv
+ *    没有使用 buffer ring(IORING_REGISTER_PBUF_RING)，有的内核上注册成功但是 recv 一直返回 ENOBUFS
+ *    这两种请求取代 POLLIN ，写事件仍然使用 POLL_ADD ；构造时实际提交一次检测内核是否支持，不支持时按就绪通知处理
+ */
+class UringPoller : public Poller
+{
+public:
+    explicit UringPoller(EventLoop *loop);
+    ~UringPoller() override;
+
+    Timestamp poll(int timeoutMs, ChannelList *activeChannels) override;
+    void updateChannel(Channel *channel) override;
+    void removeChannel(Channel *channel) override;
+
+    // 当前内核是否支持需要用到的 io_uring 特性(IORING_FEAT_EXT_ARG 等，5.11 及以上)
+    static bool isSupported();
+
+    static const unsigned kRecvBufferCount = 128;       // 提供给内核的接收缓冲区个数
+    static const unsigned kRecvBufferSize = 16 * 1024;  // 每个缓冲区的大小，multishot recv 每个 CQE 最多返回这么多数据
+
+private:
+    static const unsigned kRingEntries = 1024;
+
+    // accept/recv 请求的状态，取消之后要等内核返回最后一个 CQE 才能重新提交，否则两个请求会打乱数据的顺序
+    enum CompletionState
+    {
+        kCompletionIdle,
+        kCompletionArmed,
+        kCompletionCanceling,
+    };
+
+    // 每个 fd 在 io_uring 中的注册状态
+    struct Registration
+    {
+        Channel *channel;
+        uint32_t generation;    // 每次提交或取消 POLL_ADD 都从 nextGeneration_ 重新分配，用来识别过期的 CQE
+        uint32_t armedEvents;   // 当前已经提交的 poll 事件，0 表示没有正在等待的 poll 请求
+        bool multishot;         // 是否是 multishot poll
+        // 取消 accept/recv 时版本号不变，取消生效之前已经完成的 accept/recv 仍然交给 Channel ，不会丢掉连接或者数据
+        uint32_t completionGeneration;
+        CompletionState completionState;
+        uint64_t activeRound;   // 最近一次加入 activeChannels 的 reap 轮次，同一轮的多个 CQE 只加入一次
+    };
+    using RegistrationMap = std::unordered_map<int, Registration> ;
+
+    // 提交一次 multishot poll ，检测内核是否支持 IORING_POLL_ADD_MULTI
+    bool probeMultishot();
+    // 在一个本地监听的 Unix 域 socket 上提交 multishot accept ，检测内核是否支持 IORING_ACCEPT_MULTISHOT(5.19)
+    bool probeMultishotAccept();
+    // 用临时的 buffer group 提交 multishot recv ，检测内核是否支持 IORING_RECV_MULTISHOT(6.0)
+    bool probeMultishotRecv();
+    // 提交 SQE 并逐个检查完成的 CQE ，直到 fn 返回 true 或者超时，只在构造时检测内核特性使用
+    bool waitProbe(const std::function<bool(const io_uring_cqe&)> &fn);
+
+    // channel 是否使用 multishot poll
+    bool wantMultishot(const Channel *channel) const { return multishotSupported_ && channel->isEdgeTriggered(); }
+    // channel 需要 POLL_ADD 等待的事件，由 Poller 直接完成读操作时不再等待可读
+    static uint32_t pollEvents(const Channel *channel);
+    // 分配一个新的版本号
+    uint32_t newGeneration();
+    // 提交 POLL_ADD
+    void arm(int fd, Registration &reg);
+    // 提交 POLL_REMOVE 取消正在等待的 poll 请求
+    void disarm(int fd, Registration &reg);
+    // 按 Channel 是否关注读事件提交或者取消 accept/recv 请求
+    void updateCompletion(int fd, Registration &reg);
+    void armCompletion(int fd, Registration &reg);
+    void cancelCompletion(int fd, Registration &reg);
+    // 第一次有 Channel 使用 multishot recv 时分配接收缓冲区并提供给内核
+    void provideRecvBuffers();
+    // 数据交给 Channel 之后把缓冲区重新提供给内核
+    void recycleBuffer(uint16_t bid);
+    // 加入 activeChannels ，同一轮已经加入时合并事件
+    void markActive(Registration &reg, int revents, ChannelList *activeChannels);
+
+    // 获取一个空闲的 SQE ，提交队列满了会先提交一次
+    io_uring_sqe* getSqe();
+    // 调用 io_uring_enter 提交 SQE 并等待至少 waitNr 个完成事件
+    int enter(unsigned waitNr, int timeoutMs);
+    // 处理完成队列(CQ)中的所有事件
+    void reapCompletions(ChannelList *activeChannels);
+
+    int ringfd_;
+
+    // 提交队列
+    void *sqRingPtr_;
+    size_t sqRingSize_;
+    unsigned *sqHead_;
+    unsigned *sqTail_;
+    unsigned sqRingMask_;
+    unsigned sqRingEntries_;
+    unsigned *sqArray_;
+    io_uring_sqe *sqes_;
+    size_t sqesSize_;
+
+    // 完成队列
+    void *cqRingPtr_;
+    size_t cqRingSize_;
+    unsigned *cqHead_;
+    unsigned *cqTail_;
+    unsigned cqRingMask_;
+    io_uring_cqe *cqes_;
+
+    bool multishotSupported_;
+    bool acceptSupported_;          // 支持 multishot accept
+    bool recvSupported_;            // 支持 provided buffers + multishot recv
+    char *recvBuffers_;             // kRecvBufferCount 个 kRecvBufferSize 大小的缓冲区，没有 recv 请求之前为空
+    uint64_t reapRound_;
+    // 所有 fd 共用的版本号计数，fd 移除之后重新注册不会从 0 开始，不会和移除之前还没有返回的 CQE 重复
+    uint32_t nextGeneration_;
+    RegistrationMap registrations_;
+    std::vector<int> rearmFds_;     // 单次 poll 或者 accept/recv 请求已经结束，等待下一次 poll 时重新提交的 fd
+};
+
+#endif // URING_POLLER_H
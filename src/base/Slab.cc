@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <cstddef>
+
+#include "./base/Slab.h"
+
+FixedSizeSlab::FixedSizeSlab(size_t blocksPerChunk)
+    : blocksPerChunk_(blocksPerChunk)
+    , blockSize_(0)
+    , freeList_(nullptr)
+    , inUse_(0)
+{
+}
+
+FixedSizeSlab::~FixedSizeSlab()
+{
+    for (char *chunk : chunks_)
+    {
+        ::operator delete(chunk);
+    }
+}
+
+void* FixedSizeSlab::allocate(size_t size)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (blockSize_ == 0)
+        {
+            // 块大小按最大对齐要求向上取整，保证每个块都满足对齐
+            const size_t align = alignof(std::max_align_t);
+            blockSize_ = (std::max(size, sizeof(FreeBlock)) + align - 1) / align * align;
+        }
+        if (size <= blockSize_)
+        {
+            if (freeList_ == nullptr)
+            {
+                char *chunk = static_cast<char*>(::operator new(blockSize_ * blocksPerChunk_));
+                chunks_.push_back(chunk);
+                for (size_t i = blocksPerChunk_; i > 0; --i)
+                {
+                    FreeBlock *block = reinterpret_cast<FreeBlock*>(chunk + (i - 1) * blockSize_);
+                    block->next = freeList_;
+                    freeList_ = block;
+                }
+            }
+            FreeBlock *block = freeList_;
+            freeList_ = block->next;
+            ++inUse_;
+            return block;
+        }
+    }
+    return ::operator new(size);
+}
+
+void FixedSizeSlab::deallocate(void *p, size_t size)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (size <= blockSize_)
+        {
+            FreeBlock *block = static_cast<FreeBlock*>(p);
+            block->next = freeList_;
+            freeList_ = block;
+            --inUse_;
+            return;
+        }
+    }
+    ::operator delete(p);
+}
+
+size_t FixedSizeSlab::inUse() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return inUse_;
+}
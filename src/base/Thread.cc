@@ -1,6 +1,35 @@
 #include <semaphore.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <set>
+#include <errno.h>
 #include "./base/Thread.h"
 #include "./base/CurrentThread.h"
+#include "./log/Logging.h"
+
+// set_mempolicy 的 MPOL_LOCAL ，内存从当前运行的 CPU 所在的 NUMA 节点分配，避免依赖 libnuma 的头文件
+static const int kMpolLocal = 4;
+
+// 绑定当前线程到 cpu 上
+static void bindCurrentThread(int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int ret = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+    if (ret != 0)
+    {
+        LOG_ERROR("pthread_setaffinity_np cpu %d failed: %d", cpu, ret);
+        return;
+    }
+    // 绑定之后再设置内存策略，之后创建的 EventLoop、Buffer 等对象首次写入时都分配在本地节点上
+    // 进程被 numactl --interleave 等启动时也会覆盖继承下来的策略
+    if (::syscall(SYS_set_mempolicy, kMpolLocal, nullptr, 0) != 0)
+    {
+        LOG_DEBUG("set_mempolicy(MPOL_LOCAL) failed: %d", errno);
+    }
+}
 
 std::atomic_int32_t Thread::numCreated_(0);
 
@@ -9,7 +38,8 @@ Thread::Thread(ThreadFunc func, const std::string &name) :
     joined_(false),  // 还未设置等待线程
     tid_(0),         // 初始 tid 设置为0
     func_(std::move(func)), // EventLoopThread::threadFunc()
-    name_(name)     // 默认姓名是空字符串
+    name_(name),    // 默认姓名是空字符串
+    cpu_(-1)        // 默认不绑定 CPU
 {
     // 设置线程索引编号和姓名
     setDefaultName();
@@ -33,6 +63,12 @@ void Thread::start()
     thread_ = std::shared_ptr<std::thread>(new std::thread([&](){
         // 获取线程tid
         tid_ = CurrentThread::tid();
+        // 设置线程名，perf、top -H 中可以看到，内核限制最长 15 个字符
+        ::pthread_setname_np(::pthread_self(), name_.substr(0, 15).c_str());
+        if (cpu_ >= 0)
+        {
+            bindCurrentThread(cpu_);
+        }
         // v操作
         sem_post(&sem);
         // 开启一个新线程专门执行该线程函数
@@ -63,4 +99,44 @@ void Thread::setDefaultName()
         snprintf(buf, sizeof(buf), "Thread%d", num);
         name_ = buf;
     }
-}
\ No newline at end of file
+}
+
+std::vector<int> Thread::physicalCoreCpus()
+{
+    std::vector<int> cpus;
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (::sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    {
+        return cpus;
+    }
+
+    // 同一个物理核上的超线程 thread_siblings_list 相同，每个物理核只保留第一个可用的 CPU
+    std::set<std::string> cores;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (!CPU_ISSET(cpu, &allowed))
+        {
+            continue;
+        }
+        char path[128];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+        char siblings[256] = {0};
+        FILE *fp = ::fopen(path, "r");
+        if (fp != nullptr)
+        {
+            if (::fgets(siblings, sizeof(siblings), fp) == nullptr)
+            {
+                siblings[0] = '\0';
+            }
+            ::fclose(fp);
+        }
+        // 读取失败时当作独立的物理核
+        std::string key = siblings[0] != '\0' ? std::string(siblings) : std::to_string(cpu);
+        if (cores.insert(key).second)
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
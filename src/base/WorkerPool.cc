@@ -0,0 +1,143 @@
+#include "./base/WorkerPool.h"
+#include "./base/Thread.h"
+#include "./log/Logging.h"
+
+WorkerPool::WorkerPool(const std::string &name)
+    : name_(name)
+    , numThreads_(4)
+    , started_(false)
+    , next_(0)
+    , pending_(0)
+    , stolen_(0)
+    , running_(false)
+    , sleepers_(0)
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+    stop();
+}
+
+void WorkerPool::start()
+{
+    if (started_)
+    {
+        return;
+    }
+    started_ = true;
+    running_ = true;
+    if (numThreads_ <= 0)
+    {
+        numThreads_ = 1;
+    }
+    for (int i = 0; i < numThreads_; ++i)
+    {
+        queues_.emplace_back(new Queue);
+    }
+    for (int i = 0; i < numThreads_; ++i)
+    {
+        threads_.emplace_back(new Thread(std::bind(&WorkerPool::workerThread, this, i),
+                                         name_ + std::to_string(i)));
+        threads_.back()->start();
+    }
+}
+
+void WorkerPool::stop()
+{
+    if (!running_.exchange(false))
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        sleepCond_.notify_all();
+    }
+    for (std::unique_ptr<Thread> &thread : threads_)
+    {
+        thread->join();
+    }
+}
+
+void WorkerPool::submit(Task task)
+{
+    if (!running_)
+    {
+        // 从来没有启动过的线程池没有线程执行任务，直接丢弃会让等待结果的调用方永远挂起
+        if (!started_)
+        {
+            LOG_FATAL("WorkerPool %s: submit before start", name_.c_str());
+        }
+        return;
+    }
+    size_t index = next_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+    }
+
+    /**
+     * 先增加 pending_ 再检查 sleepers_ ，和工作线程先增加 sleepers_ 再检查 pending_ 的顺序相反
+     * 保证要么工作线程看到新任务不睡眠，要么这里看到有线程在睡眠去通知它
+     */
+    pending_.fetch_add(1);
+    if (sleepers_.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        sleepCond_.notify_one();
+    }
+}
+
+bool WorkerPool::pop(size_t index, Task *task)
+{
+    Queue &queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty())
+    {
+        return false;
+    }
+    *task = std::move(queue.tasks.front());
+    queue.tasks.pop_front();
+    return true;
+}
+
+bool WorkerPool::steal(size_t index, Task *task)
+{
+    for (size_t i = 1; i < queues_.size(); ++i)
+    {
+        Queue &queue = *queues_[(index + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            *task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            stolen_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkerPool::workerThread(size_t index)
+{
+    for (;;)
+    {
+        Task task;
+        if (pop(index, &task) || steal(index, &task))
+        {
+            pending_.fetch_sub(1);
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        sleepers_.fetch_add(1);
+        sleepCond_.wait(lock, [this]() { return pending_.load() > 0 || !running_; });
+        sleepers_.fetch_sub(1);
+        // 停止之后先执行完剩下的任务
+        if (!running_ && pending_.load() == 0)
+        {
+            return;
+        }
+    }
+}
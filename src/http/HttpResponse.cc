@@ -1,6 +1,10 @@
 #include "./http/HttpResponse.h"
 #include "./net/Buffer.h"
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
 void HttpResponse::appendHeaderToBuffer(Buffer* output) const 
 {
     char buf[32];
@@ -29,16 +33,47 @@ void HttpResponse::appendHeaderToBuffer(Buffer* output) const
     // output->append(body_) ;
 }
 
-void HttpResponse::appendBodyToBuffer(Buffer* output) const 
+bool HttpResponse::setBodyFile(const std::string& path)
+{
+    int fd = ::open(path.data(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        ::close(fd);
+        return false;
+    }
+    bodyFile_ = std::shared_ptr<int>(new int(fd), [](int *file) {
+        ::close(*file);
+        delete file;
+    });
+    body_.reset();
+    bodyLen_ = st.st_size;
+    return true;
+}
+
+void HttpResponse::appendBodyHeaderToBuffer(Buffer* output) const 
 {
-    if(body_ != nullptr)
+    if (bodyFile_ != nullptr || body_ != nullptr)
     {
         output->append("Content-Length: " + std::to_string(bodyLen_));
         output->append("\r\n\r\n");
-        output->append(body_.get() , bodyLen_) ;
     }
     else 
     {
         output->append("\r\n");
     }
-}
\ No newline at end of file
+}
+
+void HttpResponse::appendBodyToBuffer(Buffer* output) const 
+{
+    appendBodyHeaderToBuffer(output);
+    // 文件响应体由 HttpServer 调用 TcpConnection::sendFile 发送
+    if (bodyFile_ == nullptr && body_ != nullptr)
+    {
+        output->append(body_.get() , bodyLen_) ;
+    }
+}
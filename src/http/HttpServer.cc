@@ -2,6 +2,17 @@
 #include "./http/HttpRequest.h"
 #include "./http/HttpResponse.h"
 
+// 建立连接之后最多等待请求的秒数，超时之后内核仍然会交给 accept
+static const int kDeferAcceptSeconds = 10;
+
+// 请求要求或者 HTTP/1.0 默认在响应之后关闭连接
+static bool closeAfterResponse(const HttpRequest& request)
+{
+    const std::string& connection = request.getHeader("Connection");
+    return connection == "close" ||
+        (request.version() == HttpRequest::kHttp10 && connection != "Keep-Alive"); 
+}
+
 void defaultHttpCallback(const HttpRequest&, HttpResponse* resp)
 {
     resp->setStatusCode(HttpResponse::k404NotFound);
@@ -14,7 +25,8 @@ HttpServer::HttpServer(EventLoop *loop,
                        const std::string& name,
                        TcpServer::Option option)
         : server_(loop , listenAddr , name , option) , 
-          httpCallback_(defaultHttpCallback)
+          httpCallback_(defaultHttpCallback) ,
+          workerPool_(name + "Worker")
 {
     server_.setConnectionCallback(
         std::bind(&HttpServer::onConnection, this, std::placeholders::_1));
@@ -23,6 +35,21 @@ HttpServer::HttpServer(EventLoop *loop,
         std::bind(&HttpServer::onMessage, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
     
     server_.setThreadNum(4);
+
+    SocketOptions options;
+    options.deferAcceptSeconds = kDeferAcceptSeconds;
+    server_.setSocketOptions(options);
+    workerPool_.setThreadNum(kDefaultWorkerThreads);
+}
+
+void HttpServer::start()
+{
+    // 工作线程先于 loop 启动，loop 收到的第一个阻塞请求就可以提交
+    if (blockingFilter_)
+    {
+        workerPool_.start();
+    }
+    server_.start();
 }
 
 void HttpServer::onConnection(const TcpConnectionPtr& conn)
@@ -63,6 +90,14 @@ void HttpServer::onMessage(const TcpConnectionPtr& conn,
     if (requests->gotAll())
     {
         LOG_INFO("parseRequest success!") ;
+        if (blockingFilter_ && blockingFilter_(requests->request()))
+        {
+            // 响应发送之前不再读取新的请求，保证同一个连接上响应的顺序
+            conn->stopRead();
+            std::shared_ptr<HttpRequest> request(requests.release());
+            workerPool_.submit(std::bind(&HttpServer::onBlockingRequest, this, conn, request));
+            return;
+        }
         onDealRequest(conn, requests->request());
         requests->reset();
     }
@@ -70,19 +105,53 @@ void HttpServer::onMessage(const TcpConnectionPtr& conn,
 
 void HttpServer::onDealRequest(const TcpConnectionPtr& conn, const HttpRequest& request)
 {
-    const std::string& connection = request.getHeader("Connection");
-    bool close = connection == "close" ||
-        (request.version() == HttpRequest::kHttp10 && connection != "Keep-Alive"); 
-   
     //  响应信息
-    HttpResponse response(close);
+    HttpResponse response(closeAfterResponse(request));
     // httpCallback_ 由用户传入，怎么写响应体由用户决定 
     httpCallback_(request, &response);
+    sendResponse(conn, response);
+}
+
+void HttpServer::onBlockingRequest(const TcpConnectionPtr& conn, const std::shared_ptr<HttpRequest>& request)
+{
+    std::shared_ptr<HttpResponse> response(new HttpResponse(closeAfterResponse(*request)));
+    httpCallback_(*request, response.get());
+    // 回到连接所在的 loop 发送，发送之后恢复读取下一个请求
+    conn->getLoop()->queueInLoop([conn, response]() {
+        sendResponse(conn, *response);
+        conn->startRead();
+    });
+}
+
+void HttpServer::sendResponse(const TcpConnectionPtr& conn, const HttpResponse& response)
+{
     Buffer buf ; 
     response.appendHeaderToBuffer(&buf); 
-    response.appendBodyToBuffer(&buf); 
+    response.appendBodyHeaderToBuffer(&buf); 
     // LOG_INFO("bufStr = %s , buf = %d" , buf.GetBufferAllAsString().data() , buf.readableBytes()) ; 
+    // 有响应体时头部和响应体分两次写入，TCP_CORK 让头部不单独占用一个报文，
+    // 也避免 Nagle 算法下小响应体等待头部的 ACK
+    bool cork = response.bodyFile() >= 0 || response.body() != nullptr;
+    if (cork)
+    {
+        conn->setCork(true);
+    }
     conn->send(&buf);
+    // 响应体和头部分别入队，不再拼接到同一个 Buffer 中
+    if (response.bodyFile() >= 0)
+    {
+        // 文件内容通过 sendfile 直接发送
+        conn->sendFile(response.bodyFile(), 0, response.bodyLength());
+    }
+    else if (response.body() != nullptr)
+    {
+        // 没有一次发送完时发送队列只引用响应体的内存
+        conn->send(response.body(), response.body().get(), response.bodyLength());
+    }
+    if (cork)
+    {
+        conn->setCork(false);
+    }
 
     if (response.closeConnection())
     {
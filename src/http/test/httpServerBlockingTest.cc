@@ -0,0 +1,137 @@
+#include "./http/HttpServer.h"
+#include "./http/HttpRequest.h"
+#include "./http/HttpResponse.h"
+#include "./net/EventLoop.h"
+
+#include <unistd.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+/**
+ * /slow 交给工作线程池执行，阻塞 300 毫秒，/fast 在 IO loop 中直接执行
+ * 检查：
+ * 1. /slow 执行期间，同一个 loop 上其他连接的 /fast 请求不被阻塞
+ * 2. /slow 执行期间同一个连接上又发送的 /fast 在 /slow 的响应之后返回
+ */
+static const int kPort = 18911;
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static int connectServer()
+{
+    InetAddress addr(kPort, "127.0.0.1");
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (::connect(fd, addr.getSockAddr(), addr.getSockLen()) < 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void sendRequest(int fd, const std::string &path)
+{
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    ssize_t n = ::write(fd, request.data(), request.size());
+    (void)n;
+}
+
+// 读取直到收到 count 个响应体(响应体是 4 个字节的 slow 或者 fast)
+static std::string readBodies(int fd, int count)
+{
+    std::string data;
+    std::string bodies;
+    char buf[4096];
+    while (static_cast<int>(bodies.size()) < count * 4)
+    {
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n <= 0)
+        {
+            break;
+        }
+        data.append(buf, n);
+        size_t pos;
+        while ((pos = data.find("\r\n\r\n")) != std::string::npos && data.size() >= pos + 8)
+        {
+            bodies.append(data, pos + 4, 4);
+            data.erase(0, pos + 8);
+        }
+    }
+    return bodies;
+}
+
+int main()
+{
+    Logger::setLogLevel(Logger::ERROR);
+    EventLoop loop;
+    HttpServer server(&loop, InetAddress(kPort, "127.0.0.1"), "HttpServerBlockingTest");
+    server.setSocketOptions(SocketOptions());
+    server.setHttpCallback([](const HttpRequest &request, HttpResponse *response) {
+        bool slow = request.path() == "/slow";
+        if (slow)
+        {
+            ::usleep(300 * 1000);
+        }
+        response->setStatusCode(HttpResponse::k200Ok);
+        response->setStatusMessage("OK");
+        response->setBody(slow ? "slow" : "fast");
+    });
+    server.setBlockingFilter([](const HttpRequest &request) { return request.path() == "/slow"; });
+    server.start();
+
+    bool ok = true;
+    std::thread client([&ok, &loop]() {
+        ::usleep(100 * 1000);
+        // HttpServer 有 4 个 subLoop ，按轮询分配，第 1 个和第 5 个连接在同一个 loop 上
+        int fds[5];
+        for (int i = 0; i < 5; ++i)
+        {
+            fds[i] = connectServer();
+            ::usleep(10 * 1000);
+        }
+        int slowFd = fds[0];
+        int fastFd = fds[4];
+
+        // 1. 另一个连接上的 /fast 不等待 /slow
+        Clock::time_point start = Clock::now();
+        sendRequest(slowFd, "/slow");
+        ::usleep(20 * 1000);
+        Clock::time_point fastStart = Clock::now();
+        sendRequest(fastFd, "/fast");
+        std::string fast = readBodies(fastFd, 1);
+        double fastMs = elapsedMs(fastStart);
+        std::string slow = readBodies(slowFd, 1);
+        double slowMs = elapsedMs(start);
+        std::cout << "fast " << fastMs << " ms, slow " << slowMs << " ms" << std::endl;
+        ok = ok && fast == "fast" && slow == "slow" && fastMs < 100 && slowMs >= 290;
+
+        // 2. 同一个连接上的响应保持请求的顺序
+        // HttpServer 每次读事件只解析一个请求，/fast 等 /slow 被解析、连接暂停读取之后再发送
+        sendRequest(slowFd, "/slow");
+        ::usleep(20 * 1000);
+        sendRequest(slowFd, "/fast");
+        std::string ordered = readBodies(slowFd, 2);
+        std::cout << "pipelined: " << ordered << std::endl;
+        ok = ok && ordered == "slowfast";
+
+        for (int i = 0; i < 5; ++i)
+        {
+            ::close(fds[i]);
+        }
+        loop.quit();
+    });
+    loop.loop();
+    client.join();
+
+    std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -3,11 +3,15 @@
 #include "./net/InetAddress.h"
 
 #include <unistd.h> // ::close
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/socket.h>
 
-static int createNonblocking()
+static int createNonblocking(sa_family_t family)
 {
     // SOCK_CLOEXEC 字段，避免子进程执行 exec 系统调用的时候关闭该文件描述符
-    int sockfd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+    int sockfd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, family == AF_UNIX ? 0 : IPPROTO_TCP);
     if (sockfd < 0)
     {
         LOG_FATAL("listen socket create err %d" , errno) ; 
@@ -15,18 +19,28 @@ static int createNonblocking()
     return sockfd;
 }
 
+static int openIdleFd()
+{
+    return ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
 // loop 是 main_loop 用户定义的
 // ListenAddr 也是用户指定的
 Acceptor::Acceptor(EventLoop *loop, const InetAddress &ListenAddr, bool reuseport) 
     : loop_(loop),
-    acceptSocket_(createNonblocking()),
+    acceptSocket_(createNonblocking(ListenAddr.family())),
     acceptChannel_(loop, acceptSocket_.fd()),
-    listenning_(false)
+    listenning_(false),
+    maxAcceptsPerRound_(kDefaultMaxAcceptsPerRound),
+    idleFd_(openIdleFd()),
+    acceptedCount_(0),
+    shedCount_(0),
+    emfileCount_(0)
 {
     LOG_DEBUG("Acceptor create nonblocking socket, [fd = %d ]" , acceptChannel_.fd() ) ;
     
-    acceptSocket_.setReuseAddr(reuseport);
-    acceptSocket_.setReusePort(true);
+    acceptSocket_.setReuseAddr(true);
+    acceptSocket_.setReusePort(reuseport);
     acceptSocket_.bindAddress(ListenAddr);
 
     /**
@@ -34,6 +48,31 @@ Acceptor::Acceptor(EventLoop *loop, const InetAddress &ListenAddr, bool reusepor
      * 有新用户的连接，需要执行一个回调函数，获得对应连接 fd ，并建立 TcpConnection 对象 。
      */
     acceptChannel_.setReadCallback(std::bind(&Acceptor::handleRead, this));   
+    // io_uring 后端用 multishot accept 代替每个连接一次 accept4
+    acceptChannel_.setReadMode(Channel::kReadAccept);
+    acceptChannel_.setCompletionCallback(
+        std::bind(&Acceptor::handleAcceptCompletion, this, std::placeholders::_1, std::placeholders::_2));
+}
+
+Acceptor::Acceptor(EventLoop *loop, int listenfd, bool exclusive)
+    : loop_(loop),
+    acceptSocket_(listenfd),
+    acceptChannel_(loop, acceptSocket_.fd()),
+    listenning_(false),
+    maxAcceptsPerRound_(kDefaultMaxAcceptsPerRound),
+    idleFd_(openIdleFd()),
+    acceptedCount_(0),
+    shedCount_(0),
+    emfileCount_(0)
+{
+    LOG_DEBUG("Acceptor adopt listen socket, [fd = %d ]" , acceptChannel_.fd() ) ;
+
+    // 多个 loop 监听同一个 socket 时，一个新连接只唤醒其中一个 loop ，避免惊群
+    acceptChannel_.setExclusive(exclusive);
+    acceptChannel_.setReadCallback(std::bind(&Acceptor::handleRead, this));
+    acceptChannel_.setReadMode(Channel::kReadAccept);
+    acceptChannel_.setCompletionCallback(
+        std::bind(&Acceptor::handleAcceptCompletion, this, std::placeholders::_1, std::placeholders::_2));
 }
 
 // 从 Epoller 中移除 acceptFd 
@@ -41,42 +80,173 @@ Acceptor::~Acceptor()
 {    
     acceptChannel_.disableAll();    
     acceptChannel_.remove();       
+    for (int res : completedAccepts_)
+    {
+        if (res >= 0)
+        {
+            ::close(res);
+        }
+    }
+    if (idleFd_ >= 0)
+    {
+        ::close(idleFd_);
+    }
 }
 
 // 表示正在监听
 void Acceptor::listen()
 {
     listenning_ = true ;
-    acceptSocket_.listen() ; 
+    // 缓冲区大小由 accept 出来的连接继承，要在 listen 之前设置才会影响握手时的窗口扩大因子
+    if (options_.recvBufferSize > 0 && !acceptSocket_.setRecvBufferSize(options_.recvBufferSize))
+    {
+        LOG_WARN("Acceptor set SO_RCVBUF %d failed, errno = %d", options_.recvBufferSize, errno) ;
+    }
+    if (options_.sendBufferSize > 0 && !acceptSocket_.setSendBufferSize(options_.sendBufferSize))
+    {
+        LOG_WARN("Acceptor set SO_SNDBUF %d failed, errno = %d", options_.sendBufferSize, errno) ;
+    }
+    if (options_.deferAcceptSeconds > 0 && !acceptSocket_.setDeferAccept(options_.deferAcceptSeconds))
+    {
+        LOG_WARN("Acceptor set TCP_DEFER_ACCEPT failed, errno = %d", errno) ;
+    }
+    if (options_.fastOpenQueueLength > 0 && !acceptSocket_.setFastOpen(options_.fastOpenQueueLength))
+    {
+        // net.ipv4.tcp_fastopen 没有打开服务器端时同样可以正常监听，只是不走 TFO
+        LOG_WARN("Acceptor set TCP_FASTOPEN failed, errno = %d", errno) ;
+    }
+    if (options_.busyPollMicros > 0 && !acceptSocket_.setBusyPoll(options_.busyPollMicros))
+    {
+        // 超过 net.core.busy_read 需要 CAP_NET_ADMIN ，这时每个连接上的设置同样会失败
+        LOG_WARN("Acceptor set SO_BUSY_POLL %d failed, errno = %d", options_.busyPollMicros, errno) ;
+    }
+    acceptSocket_.listen(options_.backlog) ; 
     acceptChannel_.enableReading() ;
 }
 
 // listenfd 有事件发生了，就是有新用户连接了
+// 一次最多接收 maxAcceptsPerRound_ 个连接，连接风暴时不需要每个连接都经过一次 epoll_wait
 void Acceptor::handleRead()
 {
-    InetAddress peerAddr; // 保存新连接对应的 InetAddress 
-    int connfd = acceptSocket_.accept(&peerAddr); // 接受新连接 
-    if (connfd >= 0)
+    if (acceptChannel_.completionReads())
     {
-        // TcpServer 中设置了对应的回调函数，轮询找到 subLoop 唤醒并分发当前的新客户端的Channel
-        if (NewConnectionCallback_)
-        { 
-            NewConnectionCallback_(connfd, peerAddr); 
+        handleCompletedAccepts();
+        return;
+    }
+
+    for (int i = 0; i < maxAcceptsPerRound_; ++i)
+    {
+        InetAddress peerAddr; // 保存新连接对应的 InetAddress 
+        int connfd = acceptSocket_.accept(&peerAddr); // 接受新连接 
+        if (connfd >= 0)
+        {
+            newConnection(connfd, peerAddr);
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            // 已经接收完了，多个 loop 共享监听 socket 时也可能是被其他 loop 取走了
+            break;
+        }
+        else if (errno == ECONNABORTED || errno == EINTR || errno == EPROTO)
+        {
+            // 对端在 accept 之前就断开了，继续接收下一个
+            continue;
+        }
+        else if (errno == EMFILE || errno == ENFILE)
+        {
+            // 当前进程的fd已经用完了, 可以调整单个服务器的fd上限, 也可以分布式部署
+            LOG_ERROR("sockfd reached limit") ;
+            emfileCount_.fetch_add(1, std::memory_order_relaxed);
+            // fd 耗尽时即使等待队列已经空了 accept 也会返回 EMFILE ，没有可以丢弃的连接就结束本轮
+            if (!shedWithIdleFd())
+            {
+                break;
+            }
         }
         else
         {
-            LOG_ERROR("no newConnectionCallback() function") ; 
-            ::close(connfd);
+            LOG_ERROR("accept() failed, errno = %d", errno);
+            break;
         }
     }
+}
+
+void Acceptor::newConnection(int connfd, const InetAddress &peerAddr)
+{
+    // 超过连接数上限，直接关闭
+    if (admissionCallback_ && !admissionCallback_())
+    {
+        ::close(connfd);
+        shedCount_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    // TcpServer 中设置了对应的回调函数，轮询找到 subLoop 唤醒并分发当前的新客户端的Channel
+    if (NewConnectionCallback_)
+    { 
+        acceptedCount_.fetch_add(1, std::memory_order_relaxed);
+        NewConnectionCallback_(connfd, peerAddr); 
+    }
     else
     {
-        LOG_ERROR("accept() failed" ); 
-        // 当前进程的fd已经用完了, 可以调整单个服务器的fd上限, 也可以分布式部署
-        if (errno == EMFILE)
+        LOG_ERROR("no newConnectionCallback() function") ; 
+        ::close(connfd);
+    }
+}
+
+void Acceptor::handleAcceptCompletion(int res, const char *)
+{
+    completedAccepts_.push_back(res);
+}
+
+// 一轮 poll 中内核已经接收的所有连接，数量由内核决定，不受 maxAcceptsPerRound_ 限制
+void Acceptor::handleCompletedAccepts()
+{
+    std::vector<int> results;
+    results.swap(completedAccepts_);
+    for (int res : results)
+    {
+        if (res >= 0)
+        {
+            // multishot accept 不返回地址，从已经建立的连接上获取
+            sockaddr_storage addr;
+            socklen_t len = sizeof(addr);
+            ::memset(&addr, 0, sizeof(addr));
+            InetAddress peerAddr;
+            if (::getpeername(res, reinterpret_cast<sockaddr*>(&addr), &len) == 0)
+            {
+                peerAddr.setSockAddr(reinterpret_cast<sockaddr*>(&addr), len);
+            }
+            newConnection(res, peerAddr);
+        }
+        else if (res == -EMFILE || res == -ENFILE)
         {
             LOG_ERROR("sockfd reached limit") ;
+            emfileCount_.fetch_add(1, std::memory_order_relaxed);
+            // 请求已经结束，丢弃一个等待中的连接之后 Poller 在下一轮重新提交
+            shedWithIdleFd();
+        }
+        else if (res != -ECONNABORTED && res != -EINTR && res != -EPROTO && res != -EAGAIN)
+        {
+            LOG_ERROR("accept() failed, errno = %d", -res);
         }
     }
 }
 
+bool Acceptor::shedWithIdleFd()
+{
+    if (idleFd_ < 0)
+    {
+        idleFd_ = openIdleFd();
+        return false;
+    }
+    // 释放预留的 fd ，接收一个连接并立即关闭，再重新占住预留的 fd
+    ::close(idleFd_);
+    int connfd = ::accept4(acceptSocket_.fd(), nullptr, nullptr, SOCK_CLOEXEC);
+    if (connfd >= 0)
+    {
+        ::close(connfd);
+        shedCount_.fetch_add(1, std::memory_order_relaxed);
+    }
+    idleFd_ = openIdleFd();
+    return connfd >= 0;
+}
@@ -13,7 +13,7 @@ ssize_t Buffer::readFd(int fd, int *saveErrno)
 {
     /**
     * @description: 从socket读到缓冲区的方法是使用readv先读至buffer_，
-    * Buffer_空间如果不够会读入到栈上65536个字节大小的空间，然后以append的
+    * Buffer_空间如果不够会读入到线程局部的65536个字节大小的空间，然后以append的
     * 方式追加入buffer_。既考虑了避免系统调用带来开销，又不影响数据的接收。
     **/
 
@@ -29,15 +29,16 @@ ssize_t Buffer::readFd(int fd, int *saveErrno)
     const size_t writable = writableBytes();
     vec[0].iov_base = begin() + writerIndex_ ;
     vec[0].iov_len = writable ;
-    // 第二块缓冲区，栈额外空间 65536/1024 = 64KB，用于从套接字往出读时，当buffer_暂时不够用时暂存数据，待buffer_重新分配足够空间后，在把数据交换给buffer_。
-    char extrabuf[65536] = {0} ;  
+    // 第二块缓冲区，每个线程一块 64KB 的额外空间，用于从套接字往出读时，当buffer_暂时不够用时暂存数据，待buffer_重新分配足够空间后，在把数据交换给buffer_。
+    // 读入的数据会覆盖用到的部分，不需要每次清零，也不再占用栈空间
+    static thread_local char extrabuf[65536] ;
     vec[1].iov_base = extrabuf ;
     vec[1].iov_len = sizeof(extrabuf) ;
 
     // when there is enough space in this buffer, don't read into extrabuf.
     // when extrabuf is used, we read 128k-1 bytes at most.
     // 这里之所以说最多128k-1字节，是因为若writable为64k-1，那么需要两个缓冲区 第一个64k-1 第二个64k 所以做多128k-1
-    // 如果第一个缓冲区 >=64k 那就只采用一个缓冲区 而不使用栈空间extrabuf[65536]的内容
+    // 如果第一个缓冲区 >=64k 那就只采用一个缓冲区 而不使用额外空间extrabuf[65536]的内容
     const int iovcnt = (writable < sizeof(extrabuf)) ? 2 : 1;
     const ssize_t n = ::readv(fd, vec, iovcnt);
     if (n < 0)
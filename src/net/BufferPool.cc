@@ -0,0 +1,25 @@
+#include "./net/BufferPool.h"
+
+const size_t BufferPool::kMaxPooledBuffers;
+const size_t BufferPool::kMaxPooledCapacity;
+
+std::unique_ptr<Buffer> BufferPool::acquire()
+{
+    if (free_.empty())
+    {
+        return std::unique_ptr<Buffer>(new Buffer());
+    }
+    std::unique_ptr<Buffer> buffer(std::move(free_.back()));
+    free_.pop_back();
+    return buffer;
+}
+
+void BufferPool::release(std::unique_ptr<Buffer> buffer)
+{
+    if (!buffer || free_.size() >= kMaxPooledBuffers || buffer->internalCapacity() > kMaxPooledCapacity)
+    {
+        return;
+    }
+    buffer->retrieveAll();
+    free_.push_back(std::move(buffer));
+}
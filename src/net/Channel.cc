@@ -7,7 +7,10 @@ Channel::Channel(EventLoop *loop, int fd)
         fd_(fd),
         events_(0),
         revents_(0),
-        index_(-1),
+        edgeTriggered_(false),
+        exclusive_(false),
+        readMode_(kReadReadiness),
+        completionReads_(false),
         tied_(false)
 {
 }
@@ -74,13 +77,17 @@ void Channel::handleEventWithGuard(Timestamp receiveTime)
     }
 
     // 错误事件
+    // 零拷贝的完成通知也会触发 EPOLLERR ，有错误回调时由回调判断是否真的出错
     if (revents_ & (EPOLLERR))
     { 
-        LOG_ERROR("the fd = %d" , this->fd()) ; 
         if (errorCallback_)
         {
             errorCallback_();
         }
+        else
+        {
+            LOG_ERROR("the fd = %d" , this->fd()) ; 
+        }
     }
 
     // 读事件
@@ -0,0 +1,87 @@
+#include "./net/ConnectionRegistry.h"
+#include "./log/Logging.h"
+
+const uint32_t ConnectionRegistry::kMaxShards;
+const uint32_t ConnectionRegistry::kMaxSlots;
+
+uint64_t ConnectionRegistry::add(const TcpConnectionPtr &conn)
+{
+    uint32_t slot;
+    if (!freeSlots_.empty())
+    {
+        slot = freeSlots_.back();
+        freeSlots_.pop_back();
+    }
+    else
+    {
+        slot = static_cast<uint32_t>(slots_.size());
+        if (slot >= kMaxSlots)
+        {
+            LOG_FATAL("ConnectionRegistry shard %u is full", shard_);
+        }
+        // 代数从 1 开始，保证 ID 不为 0
+        slots_.push_back(Slot{1, TcpConnectionPtr()});
+    }
+    slots_[slot].conn = conn;
+    ++size_;
+    return makeId(slot);
+}
+
+bool ConnectionRegistry::remove(uint64_t id)
+{
+    if (lookup(id) == nullptr)
+    {
+        return false;
+    }
+    release(slotOf(id));
+    return true;
+}
+
+TcpConnectionPtr ConnectionRegistry::find(uint64_t id) const
+{
+    const Slot *slot = lookup(id);
+    return slot ? slot->conn : TcpConnectionPtr();
+}
+
+std::vector<TcpConnectionPtr> ConnectionRegistry::takeAll()
+{
+    std::vector<TcpConnectionPtr> conns;
+    conns.reserve(size_);
+    for (uint32_t i = 0; i < slots_.size(); ++i)
+    {
+        if (slots_[i].conn)
+        {
+            conns.push_back(slots_[i].conn);
+            release(i);
+        }
+    }
+    return conns;
+}
+
+const ConnectionRegistry::Slot* ConnectionRegistry::lookup(uint64_t id) const
+{
+    uint32_t index = slotOf(id);
+    if (index >= slots_.size())
+    {
+        return nullptr;
+    }
+    const Slot &slot = slots_[index];
+    if (shardOf(id) != shard_ || slot.generation != generationOf(id) || !slot.conn)
+    {
+        return nullptr;
+    }
+    return &slot;
+}
+
+void ConnectionRegistry::release(uint32_t index)
+{
+    Slot &slot = slots_[index];
+    slot.conn.reset();
+    // 跳过 0 ，回绕之后 ID 仍然不为 0
+    if (++slot.generation == 0)
+    {
+        slot.generation = 1;
+    }
+    freeSlots_.push_back(index);
+    --size_;
+}
@@ -0,0 +1,280 @@
+#include "./net/Connector.h"
+#include "./net/Channel.h"
+#include "./net/EventLoop.h"
+#include "./log/Logging.h"
+
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include <sys/socket.h>
+
+const int Connector::kDefaultInitRetryDelayMs;
+const int Connector::kDefaultMaxRetryDelayMs;
+
+static int createNonblocking(sa_family_t family)
+{
+    int sockfd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, family == AF_UNIX ? 0 : IPPROTO_TCP);
+    if (sockfd < 0)
+    {
+        LOG_ERROR("Connector socket create err %d", errno);
+    }
+    return sockfd;
+}
+
+// 连接本机时源端口可能恰好等于目的端口，变成自己连接自己，Unix 域 socket 不会出现
+static bool isSelfConnect(int sockfd)
+{
+    sockaddr_storage local, peer;
+    socklen_t localLen = sizeof(local);
+    socklen_t peerLen = sizeof(peer);
+    ::memset(&local, 0, sizeof(local));
+    ::memset(&peer, 0, sizeof(peer));
+    if (::getsockname(sockfd, (sockaddr *)&local, &localLen) < 0 ||
+        ::getpeername(sockfd, (sockaddr *)&peer, &peerLen) < 0 ||
+        local.ss_family == AF_UNIX)
+    {
+        return false;
+    }
+    return InetAddress((sockaddr *)&local, localLen).toIpPort() == InetAddress((sockaddr *)&peer, peerLen).toIpPort();
+}
+
+static int getSocketError(int sockfd)
+{
+    int optval = 0;
+    socklen_t optlen = sizeof(optval);
+    if (::getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &optval, &optlen) < 0)
+    {
+        return errno;
+    }
+    return optval;
+}
+
+Connector::Connector(EventLoop *loop, const InetAddress &serverAddr)
+    : loop_(loop)
+    , serverAddr_(serverAddr)
+    , connect_(false)
+    , state_(kDisconnected)
+    , connectTimeout_(0)
+    , initRetryDelayMs_(kDefaultInitRetryDelayMs)
+    , maxRetryDelayMs_(kDefaultMaxRetryDelayMs)
+    , retryDelayMs_(kDefaultInitRetryDelayMs)
+    , random_(std::random_device()())
+{
+}
+
+Connector::~Connector()
+{
+    if (channel_)
+    {
+        LOG_ERROR("Connector::~Connector still connecting to %s", serverAddr_.toIpPort().c_str());
+    }
+}
+
+void Connector::start()
+{
+    connect_ = true;
+    loop_->runInLoop(std::bind(&Connector::startInLoop, shared_from_this()));
+}
+
+void Connector::startInLoop()
+{
+    if (!connect_ || state_ != kDisconnected)
+    {
+        return;
+    }
+    connect();
+}
+
+void Connector::restart()
+{
+    setState(kDisconnected);
+    retryDelayMs_ = initRetryDelayMs_;
+    connect_ = true;
+    startInLoop();
+}
+
+void Connector::stop()
+{
+    connect_ = false;
+    loop_->queueInLoop(std::bind(&Connector::stopInLoop, shared_from_this()));
+}
+
+void Connector::stopInLoop()
+{
+    loop_->cancel(retryTimer_);
+    if (state_ == kConnecting)
+    {
+        loop_->cancel(timeoutTimer_);
+        int sockfd = removeAndResetChannel();
+        ::close(sockfd);
+        setState(kDisconnected);
+    }
+}
+
+void Connector::connect()
+{
+    int sockfd = createNonblocking(serverAddr_.family());
+    if (sockfd < 0)
+    {
+        // fd 耗尽时同样按退避时间重试
+        retry(sockfd);
+        return;
+    }
+    // 缓冲区大小要在 connect 之前设置才会影响握手时的窗口扩大因子
+    if (options_.recvBufferSize > 0)
+    {
+        ::setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &options_.recvBufferSize, sizeof(options_.recvBufferSize));
+    }
+    if (options_.sendBufferSize > 0)
+    {
+        ::setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, &options_.sendBufferSize, sizeof(options_.sendBufferSize));
+    }
+    int ret = ::connect(sockfd, serverAddr_.getSockAddr(), serverAddr_.getSockLen());
+    int savedErrno = (ret == 0) ? 0 : errno;
+    switch (savedErrno)
+    {
+    case 0:
+    case EINPROGRESS:
+    case EINTR:
+    case EISCONN:
+        connecting(sockfd);
+        break;
+
+    case EAGAIN:
+    case EADDRINUSE:
+    case EADDRNOTAVAIL:
+    case ECONNREFUSED:
+    case ENETUNREACH:
+    case ETIMEDOUT:
+    case ENOENT:    // Unix 域 socket 文件还没有创建，服务器可能还没有启动
+        retry(sockfd);
+        break;
+
+    default:
+        // EACCES、EAFNOSUPPORT 等参数错误，重试也不会成功
+        LOG_ERROR("Connector::connect to %s failed, errno = %d", serverAddr_.toIpPort().c_str(), savedErrno);
+        ::close(sockfd);
+        setState(kDisconnected);
+        break;
+    }
+}
+
+void Connector::connecting(int sockfd)
+{
+    setState(kConnecting);
+    channel_.reset(new Channel(loop_, sockfd));
+    channel_->setWriteCallback(std::bind(&Connector::handleWrite, this));
+    channel_->setErrorCallback(std::bind(&Connector::handleError, this));
+    // Connector 可能在回调执行期间被 TcpClient 释放
+    channel_->tie(shared_from_this());
+    // 非阻塞 connect 完成(成功或者失败)时 socket 可写
+    channel_->enableWriting();
+
+    if (connectTimeout_ > 0)
+    {
+        timeoutTimer_ = loop_->runAfter(connectTimeout_,
+            std::bind(&Connector::handleTimeout, std::weak_ptr<Connector>(shared_from_this()), sockfd));
+    }
+}
+
+int Connector::removeAndResetChannel()
+{
+    channel_->disableAll();
+    channel_->remove();
+    int sockfd = channel_->fd();
+    // 当前可能正在 Channel::handleEvent 中，不能直接释放 Channel
+    loop_->queueInLoop(std::bind(&Connector::resetChannel, shared_from_this()));
+    return sockfd;
+}
+
+void Connector::resetChannel()
+{
+    channel_.reset();
+}
+
+void Connector::handleWrite()
+{
+    if (state_ != kConnecting)
+    {
+        return;
+    }
+    loop_->cancel(timeoutTimer_);
+    int sockfd = removeAndResetChannel();
+    int err = getSocketError(sockfd);
+    if (err)
+    {
+        LOG_WARN("Connector::handleWrite connect to %s failed, SO_ERROR = %d", serverAddr_.toIpPort().c_str(), err);
+        retry(sockfd);
+    }
+    else if (isSelfConnect(sockfd))
+    {
+        LOG_WARN("Connector::handleWrite self connect to %s", serverAddr_.toIpPort().c_str());
+        retry(sockfd);
+    }
+    else
+    {
+        setState(kConnected);
+        if (connect_ && newConnectionCallback_)
+        {
+            newConnectionCallback_(sockfd);
+        }
+        else
+        {
+            ::close(sockfd);
+        }
+    }
+}
+
+void Connector::handleError()
+{
+    if (state_ != kConnecting)
+    {
+        return;
+    }
+    loop_->cancel(timeoutTimer_);
+    int sockfd = removeAndResetChannel();
+    LOG_WARN("Connector::handleError connect to %s, SO_ERROR = %d", serverAddr_.toIpPort().c_str(), getSocketError(sockfd));
+    retry(sockfd);
+}
+
+void Connector::handleTimeout(const std::weak_ptr<Connector> &weakConnector, int sockfd)
+{
+    std::shared_ptr<Connector> connector(weakConnector.lock());
+    // 已经连接成功或者失败过，sockfd 可能已经被关闭后复用
+    if (!connector || connector->state_ != kConnecting || !connector->channel_ || connector->channel_->fd() != sockfd)
+    {
+        return;
+    }
+    LOG_WARN("Connector connect to %s timeout after %.1f seconds", connector->serverAddr_.toIpPort().c_str(), connector->connectTimeout_);
+    connector->removeAndResetChannel();
+    connector->retry(sockfd);
+}
+
+void Connector::retry(int sockfd)
+{
+    if (sockfd >= 0)
+    {
+        ::close(sockfd);
+    }
+    setState(kDisconnected);
+    if (!connect_)
+    {
+        return;
+    }
+    // 在 [delay/2, delay] 之间随机等待，之后退避时间翻倍
+    int delayMs = retryDelayMs_ / 2 + static_cast<int>(random_() % (retryDelayMs_ / 2 + 1));
+    LOG_INFO("Connector::retry connecting to %s in %d milliseconds", serverAddr_.toIpPort().c_str(), delayMs);
+    retryTimer_ = loop_->runAfter(delayMs / 1000.0,
+        std::bind(&Connector::startAfterDelay, std::weak_ptr<Connector>(shared_from_this())));
+    retryDelayMs_ = std::min(retryDelayMs_ * 2, maxRetryDelayMs_);
+}
+
+void Connector::startAfterDelay(const std::weak_ptr<Connector> &weakConnector)
+{
+    std::shared_ptr<Connector> connector(weakConnector.lock());
+    if (connector)
+    {
+        connector->startInLoop();
+    }
+}
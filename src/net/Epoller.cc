@@ -2,7 +2,7 @@
 #include <string.h>
 
 Epoller::Epoller(EventLoop *loop) :
-        ownerLoop_(loop), 
+        Poller(loop), 
         epollfd_(::epoll_create1(EPOLL_CLOEXEC)),
         events_(kInitEventListSize)
 {
@@ -17,7 +17,7 @@ Epoller::~Epoller()
     ::close(epollfd_);
 }
 
-Timestamp Epoller::epollWait(int timeoutMs, ChannelList *activeChannels)
+Timestamp Epoller::poll(int timeoutMs, ChannelList *activeChannels)
 {
     size_t numEvents = ::epoll_wait(epollfd_, &(*events_.begin()), 
                                     static_cast<int>(events_.size()), 
@@ -38,7 +38,11 @@ Timestamp Epoller::epollWait(int timeoutMs, ChannelList *activeChannels)
     // 超时
     else if (numEvents == 0)
     {
-        LOG_DEBUG("timeout!");
+        // 忙轮询时每次 timeoutMs 为 0 的空轮询都会走到这里，不记录
+        if (timeoutMs != 0)
+        {
+            LOG_DEBUG("timeout!");
+        }
     }
     // 出错
     else
@@ -60,21 +64,15 @@ Timestamp Epoller::epollWait(int timeoutMs, ChannelList *activeChannels)
 void Epoller::updateChannel(Channel *channel)
 {
     
-    const int index = channel->index(); // 获取参数channel在epoll的状态
+    // 获取参数channel在epoll的状态，槽位中不是这个 channel 说明还没有注册过
+    ChannelTable::Slot &slot = channels_.slot(channel->fd());
+    const int index = slot.channel == channel ? slot.state : kNew;
     
     // 未添加状态和已删除状态都有可能会被再次添加到epoll中
     if (index == kNew || index == kDeleted)
     {
-        // 添加到键值对 
-        if (index == kNew)
-        {
-            int fd = channel->fd();
-            channels_[fd] = channel; 
-        }
-        // else index == kDeleted
-        
         // 修改channel的状态，此时是已添加状态
-        channel->set_index(kAdded);
+        channels_.insert(channel->fd(), channel, kAdded);
         // 向epoll对象加入channel
         update(EPOLL_CTL_ADD, channel);
     }
@@ -84,7 +82,7 @@ void Epoller::updateChannel(Channel *channel)
         if (channel->isNoneEvent())
         {
             update(EPOLL_CTL_DEL, channel);
-            channel->set_index(kDeleted);
+            slot.state = kDeleted;
         }
         // 还有事件，则 update 修改 channel 状态
         else
@@ -96,25 +94,18 @@ void Epoller::updateChannel(Channel *channel)
 
 void Epoller::removeChannel(Channel *channel)
 {
-    // 从Map中删除
     int fd = channel->fd();
-    channels_.erase(fd); 
- 
-    int index = channel->index();
-    if (index == kAdded)
+    if (channels_.find(fd) != channel)
+    {
+        return;
+    }
+    if (channels_.slot(fd).state == kAdded)
     {
         // 如果此fd已经被添加到Poller中，则还需从epoll对象中删除
         update(EPOLL_CTL_DEL, channel);
     }
-    // 重新设置channel的状态为未被Poller注册
-    channel->set_index(kNew);
-}
-
-// 判断参数channel是否在当前poller当中
-bool Epoller::hasChannel(Channel *channel) const
-{ 
-    auto it = channels_.find(channel->fd());
-    return it != channels_.end() && it->second == channel;
+    // 从表中删除，channel 的状态重新变为未被Poller注册
+    channels_.erase(fd);
 }
 
 // 真正的更新状态
@@ -125,6 +116,17 @@ void Epoller::update(int operation, Channel *channel)
 
     int fd = channel->fd();
     event.events = channel->events();
+    // 边缘触发模式只在状态变化时通知一次，由 Channel 的使用者负责读写到 EAGAIN
+    if (channel->isEdgeTriggered())
+    {
+        event.events |= EPOLLET;
+    }
+    // EPOLLEXCLUSIVE 只能在 EPOLL_CTL_ADD 时使用，并且不能和 EPOLLPRI 一起注册，否则返回 EINVAL
+    if (channel->isExclusive() && operation == EPOLL_CTL_ADD)
+    {
+        event.events &= ~EPOLLPRI;
+        event.events |= EPOLLEXCLUSIVE;
+    }
     event.data.fd = fd;
     event.data.ptr = channel;
 
@@ -146,6 +148,11 @@ void Epoller::fillActiveChannels(int numEvents, ChannelList *activeChannels) con
 {
     for (int i = 0; i < numEvents; ++i)
     { 
+        // 预取后面几个 channel ，连接很多时 channel 对象基本不在缓存中，写 revents 是这里的主要开销
+        if (i + kPrefetchDistance < numEvents)
+        {
+            __builtin_prefetch(events_[i + kPrefetchDistance].data.ptr, 1);
+        }
         Channel *channel = static_cast<Channel*>(events_[i].data.ptr);
         channel->set_revents(events_[i].events);
         activeChannels->push_back(channel);
@@ -1,9 +1,15 @@
 #include "./net/EventLoop.h"
-#include "./net/Epoller.h"
+#include "./net/Poller.h"
+#include "./net/Channel.h"
+#include "./net/TimerQueue.h"
+#include "./net/BufferPool.h"
 #include "./log/Logging.h"
 #include <unistd.h>
 #include <sys/eventfd.h>
 #include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
 
 // 防止一个线程创建多个EventLoop (thread_local)
 __thread EventLoop *t_loopInThisThread = nullptr ;
@@ -11,6 +17,9 @@ __thread EventLoop *t_loopInThisThread = nullptr ;
 // 定义默认的Epoller IO复用接口的超时时间
 const int kPollTimeMs = 10000 ;
 
+// 忙轮询连续落空时最多缩短到上限的 1/16
+const int kMinSpinShift = 4 ;
+
 // eventFd 作为唤醒的 wakeup Fd , 在 wakeupFd 写入则会唤醒对应的 loop 阻塞住的 epoll_wait  
 int createEventfd()
 {
@@ -22,16 +31,36 @@ int createEventfd()
     return evfd;
 }
 
-EventLoop::EventLoop() : 
+EventLoop::Backend EventLoop::defaultBackend()
+{
+    const char *poller = ::getenv("TINY_WEBSERVER_POLLER");
+    if (poller != nullptr && ::strcmp(poller, "io_uring") == 0)
+    {
+        return kIoUring;
+    }
+    return kEpoll;
+}
+
+EventLoop::EventLoop(Backend backend) : 
     looping_(false),
     quit_(false),
-    callingPendingFunctors_(false),
+    sleeping_(false),
     threadId_(CurrentThread::tid()),
-    epoller_(new Epoller(this)),
-    // timerQueue_(new TimerQueue(this)),
+    poller_(Poller::newPoller(this, backend == kIoUring)),
+    timerQueue_(new TimerQueue(this)),
+    bufferPool_(new BufferPool()),
     wakeupFd_(createEventfd()),
     wakeupChannel_(new Channel(this, wakeupFd_)),
-    currentActiveChannel_(nullptr)
+    currentActiveChannel_(nullptr),
+    nextActiveChannel_(0),
+    maxChannelsPerRound_(0),
+    maxFunctorsPerRound_(0),
+    roundBudgetMicros_(0),
+    callbackStartMicros_(0),
+    numConnections_(0),
+    loopLagMicros_(0),
+    busyPollMicros_(0),
+    spinMicros_(0)
 {
     if (t_loopInThisThread)
     {
@@ -50,6 +79,9 @@ EventLoop::EventLoop() :
 
 EventLoop::~EventLoop()
 {
+    // TimerQueue 析构时会移除 timerfd 的 channel ，removeChannel 要访问 activeChannels_ ，
+    // 必须在成员按声明的逆序析构之前先销毁它，否则 activeChannels_ 已经被析构
+    timerQueue_.reset();
     // channel移除所有感兴趣事件
     wakeupChannel_->disableAll();
     // 将channel从EventLoop中删除
@@ -67,23 +99,93 @@ void EventLoop::loop()
 
     LOG_INFO("EventLoop start looping") ;
 
+    // 上一轮处理结束、开始 poll 的时间
+    int64_t roundEnd = Timestamp::now().microSecondsSinceEpoch();
     while (!quit_)
     {
-        // 清空activeChannels_
-        activeChannels_.clear(); 
-        pollReturnTime_ = epoller_->epollWait(kPollTimeMs, &activeChannels_);
-        // 执行当前EventLoop事件循环需要处理的回调操作
-        for (Channel *channel : activeChannels_)
+        // 上一轮超出预算的 channel 处理完之前不 poll ，它们的 revents 不会被新的结果覆盖
+        if (nextActiveChannel_ < activeChannels_.size())
+        {
+            pollReturnTime_ = Timestamp::now();
+        }
+        else
         {
-            channel->handleEvent(pollReturnTime_);
+            // 清空activeChannels_
+            activeChannels_.clear(); 
+            nextActiveChannel_ = 0;
+            if (busyPollMicros_.load(std::memory_order_relaxed) > 0)
+            {
+                busyPoll();
+            }
+            if (activeChannels_.empty())
+            {
+                /**
+                 * 先标记即将睡眠再检查队列，和 queueInLoop 中先入队再检查 sleeping_ 的顺序相反
+                 * 保证要么这里看到新入队的回调不阻塞，要么投递方看到 sleeping_ 执行 wakeup
+                 */
+                sleeping_ = true;
+                int timeoutMs = hasPendingFunctors() ? 0 : kPollTimeMs;
+                pollReturnTime_ = poller_->poll(timeoutMs, &activeChannels_);
+                sleeping_ = false;
+            }
+            metrics_.recordPoll(pollReturnTime_.microSecondsSinceEpoch() - roundEnd, activeChannels_.size());
         }
+        callbackStartMicros_ = pollReturnTime_.microSecondsSinceEpoch();
+        metrics_.startRound(callbackStartMicros_);
+        // 连接的建立和销毁先于本轮的 IO 事件执行
+        doControlFunctors();
+        // 执行当前EventLoop事件循环需要处理的回调操作
+        handleActiveChannels();
         // 也可能存在其他线程 wakeup 该线程的 epoll ，然后执行对应的回调函数
         // 比如主线程，分发给 subloop 执行对应的回调函数，在 std::vector<Functor> pendingFunctors_ 之中
         doPendingFunctors();
+
+        // 本轮处理事件和回调的耗时，按 1/4 的权重计入滑动平均
+        roundEnd = Timestamp::now().microSecondsSinceEpoch();
+        int64_t busy = roundEnd - pollReturnTime_.microSecondsSinceEpoch();
+        int64_t lag = loopLagMicros_.load(std::memory_order_relaxed);
+        // 步长向远离 0 的方向取整，整数除法截断时差值小于 4 就不再变化，空闲之后会一直停在几微秒而不是回到 0
+        int64_t delta = busy - lag;
+        loopLagMicros_.store(lag + (delta >= 0 ? delta + 3 : delta - 3) / 4, std::memory_order_relaxed);
+        metrics_.recordRound(busy, bulkFunctors_.size());
     }
     looping_ = false;    
 }
 
+void EventLoop::busyPoll()
+{
+    const int maxSpin = busyPollMicros_.load(std::memory_order_relaxed);
+    // 刚开启或者上限被调小
+    if (spinMicros_ <= 0 || spinMicros_ > maxSpin)
+    {
+        spinMicros_ = maxSpin;
+    }
+
+    // sleeping_ 为 false ，其他线程投递回调时不会 wakeup ，这里每次轮询前检查队列
+    const int64_t deadline = Timestamp::now().microSecondsSinceEpoch() + spinMicros_;
+    while (!quit_ && !hasPendingFunctors())
+    {
+        pollReturnTime_ = poller_->poll(0, &activeChannels_);
+        if (!activeChannels_.empty())
+        {
+            // 等到了事件，说明流量密集，下一次可以多等一会
+            spinMicros_ = std::min(spinMicros_ * 2, maxSpin);
+            return;
+        }
+        if (pollReturnTime_.microSecondsSinceEpoch() >= deadline)
+        {
+            // 落空，下一次少等一会，直到上限的 1/16
+            spinMicros_ = std::max(spinMicros_ / 2, std::max(maxSpin >> kMinSpinShift, 1));
+            return;
+        }
+    }
+}
+
+void EventLoop::setBusyPoll(int spinMicros)
+{
+    busyPollMicros_.store(spinMicros > 0 ? spinMicros : 0, std::memory_order_relaxed);
+}
+
 void EventLoop::quit()
 {
     quit_ = true;
@@ -101,7 +203,7 @@ void EventLoop::quit()
 }
 
 // 在 eventLoop 中执行回调函数
-void EventLoop::runInLoop(Functor cb)
+void EventLoop::runInLoop(Functor cb, Priority priority)
 {
     // 是否在当前线程中
     if (isInLoopThread())
@@ -111,23 +213,27 @@ void EventLoop::runInLoop(Functor cb)
     // 在非当前eventLoop线程中执行回调函数，需要唤醒evevntLoop所在线程
     else
     {
-        queueInLoop(cb);
+        queueInLoop(std::move(cb), priority);
     }
 }
 
-void EventLoop::queueInLoop(Functor cb)
+void EventLoop::queueInLoop(Functor cb, Priority priority)
 {
+    if (priority == kControl)
     {
-        std::unique_lock<std::mutex> lock(mutex_);
-        pendingFunctors_.emplace_back(cb); // 使用了std::move
+        controlFunctors_.push(std::move(cb));
+    }
+    else
+    {
+        pendingFunctors_.push(std::move(cb));
     }
 
-    // 唤醒相应的，需要执行上面回调操作的loop线程
-    /**  
-     * std::atomic_bool callingPendingFunctors_ 标志当前loop是否正在执行回调操作，
-     * 因为在执行回调的过程可能会加入新的回调，则这个时候也需要唤醒，否则就会发生有事件到来但是仍被阻塞住的情况
+    /**
+     * 只有 loop 线程阻塞在 epoll_wait 中时才需要唤醒，避免每次投递都执行一次 write 系统调用
+     * exchange 保证同一次睡眠只有一个投递方去 wakeup
+     * loop 线程自己投递(比如在回调中继续 queueInLoop)时 sleeping_ 为 false，下一轮 epoll_wait 不会阻塞
      */
-    if (!isInLoopThread() || callingPendingFunctors_)
+    if (sleeping_.exchange(false))
     { 
         wakeup();
     }
@@ -151,38 +257,163 @@ void EventLoop::handleRead()
     {
         LOG_ERROR("EventLoop::handleRead() reads %d bytes instead of 8" , n);
     }
+    metrics_.recordWakeup();
+}
+
+TimerId EventLoop::runAt(Timestamp time, Functor cb)
+{
+    return timerQueue_->addTimer(std::move(cb), time, 0.0);
+}
+
+TimerId EventLoop::runAfter(double delay, Functor cb)
+{
+    Timestamp time(addTime(Timestamp::now(), delay));
+    return runAt(time, std::move(cb));
+}
+
+TimerId EventLoop::runEvery(double interval, Functor cb)
+{
+    Timestamp time(addTime(Timestamp::now(), interval));
+    return timerQueue_->addTimer(std::move(cb), time, interval);
+}
+
+void EventLoop::cancel(TimerId timerId)
+{
+    timerQueue_->cancel(timerId);
+}
+
+int64_t EventLoop::loopLagMicros() const
+{
+    // 阻塞在 poll 中说明没有积压的事件，新投递的回调可以立即执行
+    if (sleeping_.load(std::memory_order_relaxed))
+    {
+        return 0;
+    }
+    return loopLagMicros_.load(std::memory_order_relaxed);
 }
 
 void EventLoop::updateChannel(Channel *channel)
 {
-    epoller_->updateChannel(channel);
+    poller_->updateChannel(channel);
 }
 
 void EventLoop::removeChannel(Channel *channel)
 {
-    epoller_->removeChannel(channel);
+    poller_->removeChannel(channel);
+    // 还没有处理的活跃 channel 可能在移除之后被析构，不再处理它
+    for (size_t i = nextActiveChannel_; i < activeChannels_.size(); ++i)
+    {
+        if (activeChannels_[i] == channel)
+        {
+            activeChannels_[i] = nullptr;
+        }
+    }
 }
 
 bool EventLoop::hasChannel(Channel *channel)
 {
-    return epoller_->hasChannel(channel);    
+    return poller_->hasChannel(channel);    
+}
+
+void EventLoop::setRoundBudget(int maxChannels, int maxFunctors, int maxMicros)
+{
+    runInLoop([this, maxChannels, maxFunctors, maxMicros]() {
+        maxChannelsPerRound_ = maxChannels > 0 ? maxChannels : 0;
+        maxFunctorsPerRound_ = maxFunctors > 0 ? maxFunctors : 0;
+        roundBudgetMicros_ = maxMicros > 0 ? maxMicros : 0;
+    }, kControl);
+}
+
+bool EventLoop::hasPendingFunctors() const
+{
+    return !pendingFunctors_.empty() || !controlFunctors_.empty() || !bulkFunctors_.empty();
+}
+
+void EventLoop::handleActiveChannels()
+{
+    size_t end = activeChannels_.size();
+    if (maxChannelsPerRound_ > 0)
+    {
+        end = std::min(end, nextActiveChannel_ + maxChannelsPerRound_);
+    }
+    const int64_t deadline = roundBudgetMicros_ > 0
+        ? pollReturnTime_.microSecondsSinceEpoch() + roundBudgetMicros_ : 0;
+    while (nextActiveChannel_ < end)
+    {
+        // 先移动下标，处理过程中移除的 channel 只会影响后面还没有处理的
+        Channel *channel = activeChannels_[nextActiveChannel_++];
+        if (channel == nullptr)
+        {
+            continue;
+        }
+        channel->handleEvent(pollReturnTime_);
+        int64_t now = callbackDone();
+        if (deadline > 0 && now >= deadline)
+        {
+            break;
+        }
+    }
+}
+
+int64_t EventLoop::callbackDone()
+{
+    int64_t now = Timestamp::now().microSecondsSinceEpoch();
+    metrics_.recordCallback(now - callbackStartMicros_, now);
+    callbackStartMicros_ = now;
+    return now;
+}
+
+LoopMetrics::Snapshot EventLoop::metrics() const
+{
+    return metrics_.snapshot(Timestamp::now().microSecondsSinceEpoch());
+}
+
+void EventLoop::doControlFunctors()
+{
+    if (!controlFunctors_.empty())
+    {
+        size_t count = controlFunctors_.consumeAll([this](const Functor &functor) {
+            functor();
+            callbackDone();
+        });
+        metrics_.recordFunctors(count);
+    }
 }
 
 void EventLoop::doPendingFunctors()
 {
-    std::vector<Functor> functors;
-    callingPendingFunctors_ = true;
+    doControlFunctors();
 
-    // 通过这种交换的方式，减少互斥锁的加锁时间
+    // 没有预算并且没有上一轮留下的回调，一次性取出队列中的所有回调，执行期间新投递的回调留到下一轮
+    if (maxFunctorsPerRound_ == 0 && roundBudgetMicros_ == 0 && bulkFunctors_.empty())
     {
-        std::unique_lock<std::mutex> lock(mutex_);
-        functors.swap(pendingFunctors_);
+        size_t count = pendingFunctors_.consumeAll([this](const Functor &functor) {
+            functor();
+            callbackDone();
+        });
+        metrics_.recordFunctors(count);
+        return;
     }
 
-    for (const Functor &functor : functors)
+    // 新投递的回调排在上一轮留下的回调之后，保持投递顺序
+    pendingFunctors_.consumeAll([this](Functor &functor) {
+        bulkFunctors_.push_back(std::move(functor));
+    });
+    size_t limit = maxFunctorsPerRound_ > 0 ? maxFunctorsPerRound_ : bulkFunctors_.size();
+    const int64_t deadline = roundBudgetMicros_ > 0
+        ? callbackStartMicros_ + roundBudgetMicros_ : 0;
+    size_t count = 0;
+    while (count < limit && !bulkFunctors_.empty())
     {
+        Functor functor(std::move(bulkFunctors_.front()));
+        bulkFunctors_.pop_front();
         functor();
+        ++count;
+        int64_t now = callbackDone();
+        if (deadline > 0 && now >= deadline)
+        {
+            break;
+        }
     }
-
-    callingPendingFunctors_ = false;
-}
\ No newline at end of file
+    metrics_.recordFunctors(count);
+}
@@ -2,7 +2,8 @@
 #include "./net/EventLoopThread.h"
 
 EventLoopThread::EventLoopThread(const ThreadInitCallback &cb,
-                                 const std::string &name)
+                                 const std::string &name,
+                                 int cpu)
     : loop_(nullptr)
     , exiting_(false)
     , thread_(std::bind(&EventLoopThread::threadFunc, this), name) // 新线程绑定执行此函数
@@ -10,6 +11,7 @@ EventLoopThread::EventLoopThread(const ThreadInitCallback &cb,
     , cond_()
     , callback_(cb) // 传入的线程初始化回调函数，用户自定义的
 {
+    thread_.setCpuAffinity(cpu);
 }
 
 EventLoopThread::~EventLoopThread()
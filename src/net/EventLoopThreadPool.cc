@@ -1,5 +1,22 @@
 #include "./net/EventLoopThread.h"
 #include "./net/EventLoopThreadPool.h"
+#include "./net/EventLoop.h"
+#include "./net/InetAddress.h"
+
+#include <algorithm>
+#include <sys/socket.h>
+
+// FNV-1a 哈希，用于一致性哈希环
+static uint32_t fnv1a(const std::string &key)
+{
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : key)
+    {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
 
 EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop, const std::string &nameArg)
     : baseLoop_(baseLoop)
@@ -7,6 +24,8 @@ EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop, const std::string
     , started_(false)
     , numThreads_(0)
     , next_(0)
+    , policy_(kRoundRobin)
+    , rng_(std::random_device()())
 {
 }
 
@@ -23,8 +42,9 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb)
     {
         char buf[name_.size() + 32];
         snprintf(buf, sizeof(buf), "%s%d", name_.c_str(), i);
+        int cpu = cpus_.empty() ? -1 : cpus_[i % cpus_.size()];
         // 创建 EventLoopThread 对象
-        EventLoopThread *t = new EventLoopThread(cb, buf);
+        EventLoopThread *t = new EventLoopThread(cb, buf, cpu);
         // 加入此EventLoopThread入容器
         threads_.push_back(std::unique_ptr<EventLoopThread>(t));
         // 底层创建线程 绑定一个新的EventLoop 并返回该loop的地址
@@ -32,6 +52,11 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb)
         loops_.push_back(t->startLoop());                           
     }
 
+    if (policy_ == kConsistentHash)
+    {
+        buildHashRing();
+    }
+
     // 整个服务端只有一个线程运行baseLoop
     if(numThreads_ == 0 && cb)                                      
     {
@@ -63,6 +88,110 @@ EventLoop *EventLoopThreadPool::getNextLoop()
     return loop;
 }
 
+EventLoop *EventLoopThreadPool::getLoopForPeer(const InetAddress &peerAddr)
+{
+    if (loops_.empty())
+    {
+        return baseLoop_;
+    }
+
+    switch (policy_)
+    {
+    case kLeastConnections:
+    {
+        // loop 数量不多，直接遍历所有 loop 的原子计数
+        EventLoop *best = loops_[0];
+        for (EventLoop *loop : loops_)
+        {
+            if (loop->numConnections() < best->numConnections())
+            {
+                best = loop;
+            }
+        }
+        return best;
+    }
+    case kLeastLoopLag:
+    {
+        // 空闲的 loop 延迟都是 0 ，延迟相同时再比较连接数
+        EventLoop *best = loops_[0];
+        int64_t bestLag = best->loopLagMicros();
+        for (EventLoop *loop : loops_)
+        {
+            int64_t lag = loop->loopLagMicros();
+            if (lag < bestLag || (lag == bestLag && loop->numConnections() < best->numConnections()))
+            {
+                best = loop;
+                bestLag = lag;
+            }
+        }
+        return best;
+    }
+    case kPowerOfTwoChoices:
+    {
+        if (loops_.size() == 1)
+        {
+            return loops_[0];
+        }
+        // 随机选出两个不同的 loop ，只比较这两个的连接数，避免所有新连接同时涌向同一个最空闲的 loop
+        size_t first = rng_() % loops_.size();
+        size_t second = rng_() % (loops_.size() - 1);
+        if (second >= first)
+        {
+            ++second;
+        }
+        EventLoop *a = loops_[first];
+        EventLoop *b = loops_[second];
+        return a->numConnections() <= b->numConnections() ? a : b;
+    }
+    case kConsistentHash:
+    {
+        // 只按 ip 哈希，同一个客户端的多个连接落在同一个 loop 上
+        // Unix 域等没有 ip 的对端哈希值都相同，会全部落在一个 loop 上，退回轮询
+        const sa_family_t family = peerAddr.family();
+        const std::string ip = peerAddr.toIp();
+        if ((family != AF_INET && family != AF_INET6) || ip.empty())
+        {
+            return getNextLoop();
+        }
+        uint32_t hash = fnv1a(ip);
+        HashRing::const_iterator it = std::lower_bound(
+            ring_.begin(), ring_.end(), std::make_pair(hash, static_cast<size_t>(0)));
+        if (it == ring_.end())
+        {
+            it = ring_.begin();
+        }
+        return loops_[it->second];
+    }
+    case kRoundRobin:
+    default:
+        return getNextLoop();
+    }
+}
+
+void EventLoopThreadPool::buildHashRing()
+{
+    ring_.clear();
+    ring_.reserve(loops_.size() * kVirtualNodes);
+    for (size_t i = 0; i < loops_.size(); ++i)
+    {
+        for (int v = 0; v < kVirtualNodes; ++v)
+        {
+            ring_.push_back(std::make_pair(fnv1a(name_ + "#" + std::to_string(i) + "#" + std::to_string(v)), i));
+        }
+    }
+    std::sort(ring_.begin(), ring_.end());
+}
+
+std::vector<LoopMetrics::Snapshot> EventLoopThreadPool::metrics()
+{
+    std::vector<LoopMetrics::Snapshot> snapshots;
+    for (EventLoop *loop : getAllLoops())
+    {
+        snapshots.push_back(loop->metrics());
+    }
+    return snapshots;
+}
+
 std::vector<EventLoop*> EventLoopThreadPool::getAllLoops()
 {
     if(loops_.empty())
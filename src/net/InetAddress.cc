@@ -1,32 +1,148 @@
 #include "./net/InetAddress.h"
+#include "./log/Logging.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <algorithm>
 
 InetAddress::InetAddress(uint16_t port, std::string ip)
 {
-    ::bzero(&addr_, sizeof(addr_));
+    ::bzero(&addr6_, sizeof(addr6_));
+    if (ip.find(':') != std::string::npos)
+    {
+        addr6_.sin6_family = AF_INET6;
+        addr6_.sin6_port = ::htons(port);
+        if (::inet_pton(AF_INET6, ip.c_str(), &addr6_.sin6_addr) != 1)
+        {
+            LOG_ERROR("InetAddress invalid ipv6 address %s", ip.c_str());
+        }
+        return;
+    }
     addr_.sin_family = AF_INET;
     addr_.sin_port = ::htons(port);
     addr_.sin_addr.s_addr = ::inet_addr(ip.c_str());
     //addr_.sin_addr.s_addr = htonl(INADDR_ANY); // FIXME : it should be addr.ip() and need some conversion
 }
 
+InetAddress InetAddress::unixDomain(const std::string &path)
+{
+    std::shared_ptr<UnixAddress> unixAddr(new UnixAddress);
+    ::bzero(&unixAddr->addr, sizeof(unixAddr->addr));
+    unixAddr->addr.sun_family = AF_UNIX;
+    // 抽象命名空间的地址以 '\0' 开头，长度按实际名字计算，不包含结尾的 '\0'
+    // 截断之后会 bind/connect 到另一个地址，直接退出
+    if (path.size() > sizeof(unixAddr->addr.sun_path) - 1)
+    {
+        LOG_FATAL("InetAddress unix path too long: %s", path.c_str());
+    }
+    size_t n = path.size();
+    ::memcpy(unixAddr->addr.sun_path, path.data(), n);
+    if (!path.empty() && path[0] == '@')
+    {
+        unixAddr->addr.sun_path[0] = '\0';
+        unixAddr->len = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + n);
+    }
+    else
+    {
+        unixAddr->len = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + n + 1);
+    }
+
+    InetAddress addr;
+    addr.addr_.sin_family = AF_UNIX;
+    addr.unix_ = unixAddr;
+    return addr;
+}
+
+void InetAddress::setSockAddr(const sockaddr *addr, socklen_t len)
+{
+    ::bzero(&addr6_, sizeof(addr6_));
+    unix_.reset();
+    if (addr->sa_family == AF_UNIX)
+    {
+        std::shared_ptr<UnixAddress> unixAddr(new UnixAddress);
+        ::bzero(&unixAddr->addr, sizeof(unixAddr->addr));
+        unixAddr->len = std::min(len, static_cast<socklen_t>(sizeof(unixAddr->addr)));
+        ::memcpy(&unixAddr->addr, addr, unixAddr->len);
+        addr_.sin_family = AF_UNIX;
+        unix_ = unixAddr;
+    }
+    else if (addr->sa_family == AF_INET6)
+    {
+        ::memcpy(&addr6_, addr, std::min(len, static_cast<socklen_t>(sizeof(addr6_))));
+    }
+    else
+    {
+        ::memcpy(&addr_, addr, std::min(len, static_cast<socklen_t>(sizeof(addr_))));
+    }
+}
+
+socklen_t InetAddress::getSockLen() const
+{
+    if (unix_)
+    {
+        return unix_->len;
+    }
+    return family() == AF_INET6 ? sizeof(sockaddr_in6) : sizeof(sockaddr_in);
+}
+
 std::string InetAddress::toIp() const
 {
+    if (unix_)
+    {
+        size_t pathLen = unix_->len > offsetof(sockaddr_un, sun_path) ? unix_->len - offsetof(sockaddr_un, sun_path) : 0;
+        if (pathLen == 0)
+        {
+            return std::string();
+        }
+        if (unix_->addr.sun_path[0] == '\0')
+        {
+            return "@" + std::string(unix_->addr.sun_path + 1, pathLen - 1);
+        }
+        return std::string(unix_->addr.sun_path, ::strnlen(unix_->addr.sun_path, pathLen));
+    }
     char buf[64] = {0};
-    ::inet_ntop(AF_INET, &addr_.sin_addr, buf, sizeof(buf));
+    if (family() == AF_INET6)
+    {
+        ::inet_ntop(AF_INET6, &addr6_.sin6_addr, buf, sizeof(buf));
+    }
+    else
+    {
+        ::inet_ntop(AF_INET, &addr_.sin_addr, buf, sizeof(buf));
+    }
     return buf;
 }
 
 uint16_t InetAddress::toPort() const
 {
+    if (unix_)
+    {
+        return 0;
+    }
+    // sin_port 和 sin6_port 的偏移相同
     return ::ntohs(addr_.sin_port);
 }
 
 std::string InetAddress::toIpPort() const
 {
+    if (unix_)
+    {
+        return "unix:" + toIp();
+    }
     char buf[64] = {0};
-    ::inet_ntop(AF_INET, &addr_.sin_addr, buf, sizeof(buf));
-    size_t end = ::strlen(buf);
+    size_t end = 0;
+    if (family() == AF_INET6)
+    {
+        buf[0] = '[';
+        ::inet_ntop(AF_INET6, &addr6_.sin6_addr, buf + 1, sizeof(buf) - 1);
+        end = ::strlen(buf);
+        buf[end++] = ']';
+    }
+    else
+    {
+        ::inet_ntop(AF_INET, &addr_.sin_addr, buf, sizeof(buf));
+        end = ::strlen(buf);
+    }
     uint16_t port = ::ntohs(addr_.sin_port);
-    sprintf(buf+end, ":%u", port);
+    snprintf(buf + end, sizeof(buf) - end, ":%u", port);
     return buf;
 }
@@ -0,0 +1,173 @@
+#include "./net/LoopMetrics.h"
+
+#include <stdio.h>
+
+namespace
+{
+
+int bucketOf(int64_t value)
+{
+    if (value <= 0)
+    {
+        return 0;
+    }
+    int bucket = 64 - __builtin_clzll(static_cast<unsigned long long>(value));
+    return bucket < LoopMetrics::kBuckets ? bucket : LoopMetrics::kBuckets - 1;
+}
+
+} // namespace
+
+int64_t LoopMetrics::Histogram::total() const
+{
+    int64_t sum = 0;
+    for (int i = 0; i < kBuckets; ++i)
+    {
+        sum += counts[i];
+    }
+    return sum;
+}
+
+int64_t LoopMetrics::Histogram::percentile(double p) const
+{
+    int64_t sum = total();
+    if (sum == 0)
+    {
+        return 0;
+    }
+    int64_t rank = static_cast<int64_t>(p * sum);
+    int64_t seen = 0;
+    for (int i = 0; i < kBuckets; ++i)
+    {
+        seen += counts[i];
+        if (seen > rank)
+        {
+            return i == 0 ? 0 : (int64_t(1) << i) - 1;
+        }
+    }
+    return (int64_t(1) << (kBuckets - 1)) - 1;
+}
+
+double LoopMetrics::Snapshot::utilization() const
+{
+    int64_t total = pollMicros + busyMicros;
+    return total > 0 ? static_cast<double>(busyMicros) / total : 0;
+}
+
+std::string LoopMetrics::Snapshot::toString() const
+{
+    char buf[512];
+    snprintf(buf, sizeof buf,
+             "iterations=%lld util=%.2f wakeups=%lld events=%lld functors=%lld backlog=%lld "
+             "active p50/p99=%lld/%lld functors p50/p99=%lld/%lld round p50/p99=%lld/%lldus "
+             "slowest=%lldus current=%lldus",
+             (long long)iterations, utilization(), (long long)wakeups, (long long)events,
+             (long long)functors, (long long)backlog,
+             (long long)activeChannels.percentile(0.5), (long long)activeChannels.percentile(0.99),
+             (long long)functorsPerRound.percentile(0.5), (long long)functorsPerRound.percentile(0.99),
+             (long long)roundMicros.percentile(0.5), (long long)roundMicros.percentile(0.99),
+             (long long)slowestCallbackMicros, (long long)currentRoundMicros);
+    return buf;
+}
+
+LoopMetrics::AtomicHistogram::AtomicHistogram()
+{
+    for (int i = 0; i < kBuckets; ++i)
+    {
+        counts_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void LoopMetrics::AtomicHistogram::add(int64_t value)
+{
+    LoopMetrics::add(counts_[bucketOf(value)], 1);
+}
+
+void LoopMetrics::AtomicHistogram::load(Histogram *histogram) const
+{
+    for (int i = 0; i < kBuckets; ++i)
+    {
+        histogram->counts[i] = counts_[i].load(std::memory_order_relaxed);
+    }
+}
+
+LoopMetrics::LoopMetrics()
+    : iterations_(0)
+    , pollMicros_(0)
+    , busyMicros_(0)
+    , wakeups_(0)
+    , events_(0)
+    , functors_(0)
+    , backlog_(0)
+    , roundStartMicros_(0)
+    , slowestLastInterval_(0)
+    , slowestThisInterval_(0)
+    , intervalStartMicros_(0)
+    , roundFunctors_(0)
+{
+}
+
+void LoopMetrics::rollInterval(int64_t nowMicros)
+{
+    if (nowMicros - intervalStartMicros_ >= kIntervalMicros)
+    {
+        slowestLastInterval_.store(slowestThisInterval_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        slowestThisInterval_.store(0, std::memory_order_relaxed);
+        intervalStartMicros_ = nowMicros;
+    }
+}
+
+void LoopMetrics::recordPoll(int64_t pollMicros, size_t activeChannels)
+{
+    add(pollMicros_, pollMicros);
+    add(events_, static_cast<int64_t>(activeChannels));
+    activeChannels_.add(static_cast<int64_t>(activeChannels));
+}
+
+void LoopMetrics::startRound(int64_t nowMicros)
+{
+    roundStartMicros_.store(nowMicros, std::memory_order_relaxed);
+    roundFunctors_ = 0;
+
+    // 每轮开始时也检查一次，没有回调的 loop 同样会进入下一个统计周期
+    rollInterval(nowMicros);
+}
+
+void LoopMetrics::recordCallback(int64_t micros, int64_t nowMicros)
+{
+    rollInterval(nowMicros);
+    if (micros > slowestThisInterval_.load(std::memory_order_relaxed))
+    {
+        slowestThisInterval_.store(micros, std::memory_order_relaxed);
+    }
+}
+
+void LoopMetrics::recordRound(int64_t busyMicros, size_t backlog)
+{
+    add(iterations_, 1);
+    add(busyMicros_, busyMicros);
+    roundMicros_.add(busyMicros);
+    functorsPerRound_.add(static_cast<int64_t>(roundFunctors_));
+    backlog_.store(static_cast<int64_t>(backlog), std::memory_order_relaxed);
+    roundStartMicros_.store(0, std::memory_order_relaxed);
+}
+
+LoopMetrics::Snapshot LoopMetrics::snapshot(int64_t nowMicros) const
+{
+    Snapshot snap;
+    snap.iterations = iterations_.load(std::memory_order_relaxed);
+    snap.pollMicros = pollMicros_.load(std::memory_order_relaxed);
+    snap.busyMicros = busyMicros_.load(std::memory_order_relaxed);
+    snap.wakeups = wakeups_.load(std::memory_order_relaxed);
+    snap.events = events_.load(std::memory_order_relaxed);
+    snap.functors = functors_.load(std::memory_order_relaxed);
+    snap.backlog = backlog_.load(std::memory_order_relaxed);
+    int64_t last = slowestLastInterval_.load(std::memory_order_relaxed);
+    int64_t current = slowestThisInterval_.load(std::memory_order_relaxed);
+    snap.slowestCallbackMicros = last > current ? last : current;
+    int64_t roundStart = roundStartMicros_.load(std::memory_order_relaxed);
+    snap.currentRoundMicros = roundStart > 0 && nowMicros > roundStart ? nowMicros - roundStart : 0;
+    activeChannels_.load(&snap.activeChannels);
+    functorsPerRound_.load(&snap.functorsPerRound);
+    roundMicros_.load(&snap.roundMicros);
+    return snap;
+}
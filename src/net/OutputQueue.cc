@@ -0,0 +1,285 @@
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+
+#include "./net/OutputQueue.h"
+#include "./log/Logging.h"
+
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+
+const size_t OutputQueue::kBlockSize;
+const int OutputQueue::kMaxIovecs;
+
+void OutputQueue::append(const char *data, size_t len)
+{
+    if (len == 0)
+    {
+        return;
+    }
+    readableBytes_ += len;
+
+    // 先填满队尾块剩余的空间
+    if (!chunks_.empty() && chunks_.back().avail > 0)
+    {
+        Chunk &tail = chunks_.back();
+        size_t n = std::min(len, tail.avail);
+        ::memcpy(const_cast<char *>(tail.data) + tail.len, data, n);
+        tail.len += n;
+        tail.avail -= n;
+        data += n;
+        len -= n;
+    }
+
+    if (len > 0)
+    {
+        size_t capacity = std::max(len, kBlockSize);
+        std::shared_ptr<char> block(new char[capacity], std::default_delete<char[]>());
+        ::memcpy(block.get(), data, len);
+
+        Chunk chunk;
+        chunk.holder = block;
+        chunk.external = false;
+        chunk.data = block.get();
+        chunk.len = len;
+        chunk.avail = capacity - len;
+        chunk.offset = 0;
+        chunks_.push_back(chunk);
+    }
+}
+
+void OutputQueue::append(const std::shared_ptr<const char> &holder, const char *data, size_t len)
+{
+    if (len == 0)
+    {
+        return;
+    }
+    readableBytes_ += len;
+
+    Chunk chunk;
+    chunk.holder = holder;
+    chunk.external = true;
+    chunk.data = data;
+    chunk.len = len;
+    chunk.avail = 0;
+    chunk.offset = 0;
+    chunks_.push_back(chunk);
+}
+
+void OutputQueue::appendFile(int fd, off_t offset, size_t len)
+{
+    std::shared_ptr<int> file(new int(fd), [](int *f) {
+        ::close(*f);
+        delete f;
+    });
+    if (len == 0)
+    {
+        return;
+    }
+    readableBytes_ += len;
+
+    Chunk chunk;
+    chunk.external = false;
+    chunk.data = nullptr;
+    chunk.len = len;
+    chunk.avail = 0;
+    chunk.file = file;
+    chunk.offset = offset;
+    chunks_.push_back(chunk);
+}
+
+ssize_t OutputQueue::writeFd(int fd, int *saveErrno)
+{
+    while (!chunks_.empty() && front().file)
+    {
+        Chunk &chunk = front();
+        ssize_t n = ::sendfile(fd, *chunk.file, &chunk.offset, chunk.len);
+        if (n > 0)
+        {
+            chunk.len -= n;
+            readableBytes_ -= n;
+            if (chunk.len == 0)
+            {
+                popFront();
+            }
+            return n;
+        }
+        if (n < 0)
+        {
+            *saveErrno = errno;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                return n;
+            }
+        }
+        // 文件被截断(返回 0)或者出错，丢弃这个文件剩下的部分
+        LOG_ERROR("OutputQueue::writeFd sendfile failed, drop %zu bytes, errno = %d", chunk.len, n < 0 ? *saveErrno : 0);
+        readableBytes_ -= chunk.len;
+        popFront();
+        if (n < 0)
+        {
+            return n;
+        }
+    }
+
+    if (chunks_.empty())
+    {
+        return 0;
+    }
+
+    // 把队首连续的内存块一起提交，遇到文件片段为止
+    struct iovec vec[kMaxIovecs];
+    int iovcnt = 0;
+    bool zeroCopy = false;
+    for (std::vector<Chunk>::const_iterator it = chunks_.begin() + head_;
+         it != chunks_.end() && iovcnt < kMaxIovecs && !it->file; ++it)
+    {
+        vec[iovcnt].iov_base = const_cast<char *>(it->data);
+        vec[iovcnt].iov_len = it->len;
+        ++iovcnt;
+        // 自己分配的块已经拷贝过一次，只有外部的大块内存才值得锁定页面
+        if (zeroCopyThreshold_ > 0 && it->external && it->len >= zeroCopyThreshold_)
+        {
+            zeroCopy = true;
+        }
+    }
+
+    ssize_t n = 0;
+    if (zeroCopy)
+    {
+        struct msghdr msg;
+        ::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = vec;
+        msg.msg_iovlen = iovcnt;
+        n = ::sendmsg(fd, &msg, MSG_ZEROCOPY);
+        if (n < 0 && errno == ENOBUFS)
+        {
+            // 等待通知的零拷贝发送太多，超过了 optmem_max ，这一次退回普通发送
+            zeroCopy = false;
+            n = ::writev(fd, vec, iovcnt);
+        }
+    }
+    else
+    {
+        n = ::writev(fd, vec, iovcnt);
+    }
+    if (n < 0)
+    {
+        *saveErrno = errno;
+        return n;
+    }
+    if (zeroCopy)
+    {
+        pin(n);
+    }
+    consume(n);
+    return n;
+}
+
+void OutputQueue::pin(size_t n)
+{
+    PinnedSend send;
+    send.seq = zeroCopyNextSeq_++;
+    for (std::vector<Chunk>::const_iterator it = chunks_.begin() + head_; n > 0; ++it)
+    {
+        send.holders.push_back(it->holder);
+        n -= std::min(n, it->len);
+    }
+    pinned_.push_back(std::move(send));
+}
+
+int OutputQueue::handleZeroCopyCompletions(int fd)
+{
+    int completions = 0;
+    while (true)
+    {
+        char control[128];
+        struct msghdr msg;
+        ::memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        // 错误队列读完时返回 EAGAIN
+        if (::recvmsg(fd, &msg, MSG_ERRQUEUE) < 0)
+        {
+            break;
+        }
+
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+                !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))
+            {
+                continue;
+            }
+            const struct sock_extended_err *err = reinterpret_cast<const struct sock_extended_err *>(CMSG_DATA(cm));
+            if (err->ee_errno != 0 || err->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+            {
+                continue;
+            }
+
+            // 一个通知覆盖 [ee_info, ee_data] 区间内的所有发送，序号会回绕，按无符号差值比较
+            uint32_t lo = err->ee_info;
+            uint32_t hi = err->ee_data;
+            size_t before = pinned_.size();
+            pinned_.erase(std::remove_if(pinned_.begin(), pinned_.end(),
+                                         [lo, hi](const PinnedSend &send) { return send.seq - lo <= hi - lo; }),
+                          pinned_.end());
+            if (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+            {
+                zeroCopyCopied_ += before - pinned_.size();
+            }
+            if (pinned_.empty())
+            {
+                std::vector<PinnedSend>().swap(pinned_);
+            }
+            ++completions;
+        }
+    }
+    return completions;
+}
+
+void OutputQueue::consume(size_t n)
+{
+    readableBytes_ -= n;
+    while (n > 0)
+    {
+        Chunk &chunk = front();
+        if (n >= chunk.len)
+        {
+            n -= chunk.len;
+            popFront();
+        }
+        else
+        {
+            // 部分发送，自己分配的块尾部空间仍然可以继续追加
+            chunk.data += n;
+            chunk.len -= n;
+            n = 0;
+        }
+    }
+}
+
+void OutputQueue::popFront()
+{
+    // 立即释放发送完的内存块或者关闭文件
+    chunks_[head_] = Chunk();
+    ++head_;
+    if (head_ == chunks_.size())
+    {
+        std::vector<Chunk>().swap(chunks_);
+        head_ = 0;
+    }
+    else if (head_ >= 32 && head_ * 2 >= chunks_.size())
+    {
+        // 前面空出来的位置过多时整体前移
+        chunks_.erase(chunks_.begin(), chunks_.begin() + head_);
+        head_ = 0;
+    }
+}
@@ -0,0 +1,24 @@
+#include "./net/Poller.h"
+#include "./net/Channel.h"
+#include "./net/Epoller.h"
+#include "./net/UringPoller.h"
+#include "./log/Logging.h"
+
+// 判断参数channel是否在当前poller当中
+bool Poller::hasChannel(Channel *channel) const
+{ 
+    return channels_.find(channel->fd()) == channel;
+}
+
+Poller* Poller::newPoller(EventLoop *loop, bool useIoUring)
+{
+    if (useIoUring)
+    {
+        if (UringPoller::isSupported())
+        {
+            return new UringPoller(loop);
+        }
+        LOG_WARN("io_uring is not supported by this kernel, fall back to epoll") ;
+    }
+    return new Epoller(loop);
+}
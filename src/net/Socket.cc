@@ -2,25 +2,61 @@
 #include "./log/Logging.h"
 #include "./net/InetAddress.h"
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <netinet/tcp.h>
+#include <errno.h>
 
 Socket::~Socket()
 {
     ::close(sockfd_);
 }
 
+/**
+ * path 是否是上次进程退出后残留的 Unix 域 socket 文件
+ * 只有 socket 类型的文件，并且用同类型的 socket 连接时被拒绝(没有进程在监听)才算残留，
+ * 普通文件和仍然有进程在使用的 socket 都不能删除，之后 bind 会因为地址已被占用而失败
+ */
+static bool isStaleUnixSocket(int sockfd, const InetAddress &addr, const std::string &path)
+{
+    struct stat st;
+    if (::lstat(path.c_str(), &st) != 0 || !S_ISSOCK(st.st_mode))
+    {
+        return false;
+    }
+    int type = SOCK_STREAM;
+    socklen_t len = static_cast<socklen_t>(sizeof(type));
+    ::getsockopt(sockfd, SOL_SOCKET, SO_TYPE, &type, &len);
+    int probefd = ::socket(AF_UNIX, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (probefd < 0)
+    {
+        return false;
+    }
+    bool stale = ::connect(probefd, addr.getSockAddr(), addr.getSockLen()) < 0 && errno == ECONNREFUSED;
+    ::close(probefd);
+    return stale;
+}
+
 void Socket::bindAddress(const InetAddress &localaddr)
 {
-    if (0 != ::bind(sockfd_, (sockaddr *)localaddr.getSockAddr(), sizeof(sockaddr_in)))
+    if (localaddr.family() == AF_UNIX)
+    {
+        // 文件系统中的 Unix 域 socket 文件在进程退出后仍然存在，重启时删除残留的文件，抽象命名空间(以 '@' 开头)不需要
+        std::string path = localaddr.toIp();
+        if (!path.empty() && path[0] != '@' && isStaleUnixSocket(sockfd_, localaddr, path))
+        {
+            ::unlink(path.c_str());
+        }
+    }
+    if (0 != ::bind(sockfd_, localaddr.getSockAddr(), localaddr.getSockLen()))
     {
         LOG_FATAL("bind sockfd: %d fail" , sockfd_) ; 
     }
 }
 
-void Socket::listen() 
+void Socket::listen(int backlog) 
 {
-    if (0 != ::listen(sockfd_, 1024))
+    if (0 != ::listen(sockfd_, backlog))
     {
         LOG_FATAL("listen sockfd: %d fail" , sockfd_) ;
     }
@@ -28,15 +64,16 @@ void Socket::listen()
 
 int Socket::accept(InetAddress *peeraddr) 
 {
-    sockaddr_in addr;
+    // 足够放下三种地址族中的任意一种
+    sockaddr_storage addr;
     socklen_t len = sizeof(addr);
     ::memset(&addr, 0, sizeof(addr));
     int connfd = ::accept4(sockfd_, (sockaddr *)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
     if (connfd >= 0) 
     {
-        peeraddr->setSockAddr(addr) ; 
+        peeraddr->setSockAddr((sockaddr *)&addr, len) ; 
     }
-    else 
+    else if (errno != EAGAIN && errno != EWOULDBLOCK)
     {
         LOG_ERROR("accept4() failed") ;
     }
@@ -78,4 +115,41 @@ void Socket::setKeepAlive(bool on)
 {
     int optval = on ? 1 : 0;
     ::setsockopt(sockfd_, SOL_SOCKET, SO_KEEPALIVE, &optval, sizeof(optval)); 
-}
\ No newline at end of file
+}
+
+bool Socket::setZeroCopy(bool on)
+{
+    int optval = on ? 1 : 0;
+    return ::setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &optval, sizeof(optval)) == 0;
+}
+
+bool Socket::setDeferAccept(int seconds)
+{
+    return ::setsockopt(sockfd_, IPPROTO_TCP, TCP_DEFER_ACCEPT, &seconds, sizeof(seconds)) == 0;
+}
+
+bool Socket::setFastOpen(int queueLength)
+{
+    return ::setsockopt(sockfd_, IPPROTO_TCP, TCP_FASTOPEN, &queueLength, sizeof(queueLength)) == 0;
+}
+
+bool Socket::setCork(bool on)
+{
+    int optval = on ? 1 : 0;
+    return ::setsockopt(sockfd_, IPPROTO_TCP, TCP_CORK, &optval, sizeof(optval)) == 0;
+}
+
+bool Socket::setRecvBufferSize(int bytes)
+{
+    return ::setsockopt(sockfd_, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes)) == 0;
+}
+
+bool Socket::setSendBufferSize(int bytes)
+{
+    return ::setsockopt(sockfd_, SOL_SOCKET, SO_SNDBUF, &bytes, sizeof(bytes)) == 0;
+}
+
+bool Socket::setBusyPoll(int micros)
+{
+    return ::setsockopt(sockfd_, SOL_SOCKET, SO_BUSY_POLL, &micros, sizeof(micros)) == 0;
+}
@@ -0,0 +1,134 @@
+#include "./net/TcpClient.h"
+#include "./net/EventLoop.h"
+#include "./log/Logging.h"
+
+#include <string.h>
+#include <sys/socket.h>
+
+// TcpClient 析构之后连接才断开时，只需要销毁连接
+static void removeConnectionAfterClient(EventLoop *loop, const TcpConnectionPtr &conn)
+{
+    loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn), EventLoop::kControl);
+}
+
+TcpClient::TcpClient(EventLoop *loop,
+                     const InetAddress &serverAddr,
+                     const std::string &nameArg)
+    : loop_(loop)
+    , connector_(new Connector(loop, serverAddr))
+    , name_(nameArg)
+    , namePrefix_(std::make_shared<const std::string>(nameArg + "-" + serverAddr.toIpPort()))
+    , connectionCallback_()
+    , messageCallback_()
+    , writeCompleteCallback_()
+    , retry_(false)
+    , connect_(false)
+    , nextConnId_(1)
+{
+    connector_->setNewConnectionCallback(
+        std::bind(&TcpClient::newConnection, this, std::placeholders::_1));
+    LOG_INFO("TcpClient::TcpClient [ %s ] - connector %p", name_.c_str(), connector_.get());
+}
+
+TcpClient::~TcpClient()
+{
+    LOG_INFO("TcpClient::~TcpClient [ %s ] - connector %p", name_.c_str(), connector_.get());
+    TcpConnectionPtr conn;
+    bool unique = false;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        unique = connection_.use_count() == 1;
+        conn = connection_;
+    }
+    if (conn)
+    {
+        // 连接可能比 TcpClient 活得更久，之后断开时不能再回调到已经析构的 TcpClient
+        EventLoop *loop = loop_;
+        loop_->runInLoop([conn, loop]() {
+            conn->setCloseCallback(std::bind(&removeConnectionAfterClient, loop, std::placeholders::_1));
+        });
+        if (unique)
+        {
+            conn->forceClose();
+        }
+    }
+    else
+    {
+        // 正在连接或者等待重试，Connector 由 stop 排入的任务持有，loop 执行之后才释放
+        connector_->stop();
+    }
+}
+
+void TcpClient::connect()
+{
+    LOG_INFO("TcpClient::connect [ %s ] - connecting to %s", name_.c_str(), connector_->serverAddress().toIpPort().c_str());
+    connect_ = true;
+    connector_->start();
+}
+
+void TcpClient::disconnect()
+{
+    connect_ = false;
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (connection_)
+    {
+        connection_->shutdown();
+    }
+}
+
+void TcpClient::stop()
+{
+    connect_ = false;
+    connector_->stop();
+}
+
+void TcpClient::newConnection(int sockfd)
+{
+    sockaddr_storage local, peer;
+    socklen_t localLen = sizeof(local);
+    socklen_t peerLen = sizeof(peer);
+    ::memset(&local, 0, sizeof(local));
+    ::memset(&peer, 0, sizeof(peer));
+    if (::getsockname(sockfd, (sockaddr *)&local, &localLen) < 0)
+    {
+        LOG_ERROR("sockets::getLocalAddr() failed");
+    }
+    if (::getpeername(sockfd, (sockaddr *)&peer, &peerLen) < 0)
+    {
+        LOG_ERROR("sockets::getPeerAddr() failed");
+    }
+
+    TcpConnectionPtr conn(new TcpConnection(loop_, namePrefix_, sockfd,
+                                            InetAddress((sockaddr *)&local, localLen),
+                                            InetAddress((sockaddr *)&peer, peerLen)));
+    // 客户端只有一条连接，ID 就是第几次建立连接，名字显示为 namePrefix#0.序号.0
+    conn->setId(nextConnId_++);
+    LOG_INFO("TcpClient::newConnection [ %s ] - new connection [ %s ]", name_.c_str(), conn->name().c_str());
+
+    conn->setConnectionCallback(connectionCallback_);
+    conn->setMessageCallback(messageCallback_);
+    conn->setWriteCompleteCallback(writeCompleteCallback_);
+    conn->setSocketOptions(socketOptions_);
+    conn->setCloseCallback(
+        std::bind(&TcpClient::removeConnection, this, std::placeholders::_1));
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        connection_ = conn;
+    }
+    conn->connectEstablished();
+}
+
+void TcpClient::removeConnection(const TcpConnectionPtr &conn)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        connection_.reset();
+    }
+    loop_->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn), EventLoop::kControl);
+    if (retry_ && connect_)
+    {
+        LOG_INFO("TcpClient::removeConnection [ %s ] - reconnecting to %s", name_.c_str(), connector_->serverAddress().toIpPort().c_str());
+        // 重连时退避时间从初始值重新开始
+        connector_->restart();
+    }
+}
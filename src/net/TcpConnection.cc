@@ -3,13 +3,24 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <string.h>
+#include <stdio.h>
 #include <netinet/tcp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
 
 #include "./net/TcpConnection.h"
 #include "./log/Logging.h"
-#include "./net/Socket.h"
-#include "./net/Channel.h"
 #include "./net/EventLoop.h"
+#include "./net/BufferPool.h"
+#include "./net/ConnectionRegistry.h"
+
+const size_t TcpConnection::kMinReadSize;
+const size_t TcpConnection::kMaxReadSize;
+
+// 按最大读取大小扩容之后的接收缓冲区要能放回 BufferPool ，否则高吞吐的连接每次都要重新分配
+static_assert(TcpConnection::kMaxReadSize + Buffer::kCheapPrepend <= BufferPool::kMaxPooledCapacity,
+              "receive buffer at kMaxReadSize must be reusable by BufferPool");
 
 static EventLoop *CheckLoopNotNull(EventLoop *loop)
 {
@@ -23,37 +34,60 @@ static EventLoop *CheckLoopNotNull(EventLoop *loop)
 }
 
 TcpConnection::TcpConnection(EventLoop *loop,
-                             const std::string &nameArg,
+                             const std::shared_ptr<const std::string> &namePrefix,
                              int sockfd,
                              const InetAddress &localAddr,
                              const InetAddress &peerAddr)
     : loop_(CheckLoopNotNull(loop))
-    , name_(nameArg)
+    , namePrefix_(namePrefix)
+    , id_(0)
     , state_(kConnecting)
     , reading_(true)
-    , socket_(new Socket(sockfd))
-    , channel_(new Channel(loop, sockfd))
+    , edgeTriggered_(false)
+    , maxBytesPerRound_(kDefaultMaxBytesPerRound)
+    , socket_(sockfd)
+    , channel_(loop, sockfd)
     , localAddr_(localAddr)
     , peerAddr_(peerAddr)
     , highWaterMark_(64 * 1024 * 1024) // 64M 避免发送太快对方接受太慢
+    , backpressureHigh_(0)
+    , backpressureLow_(0)
+    , evictSeconds_(0)
+    , backpressured_(false)
+    , readSizeHint_(Buffer::kInitialSize)
+    , smallReads_(0)
+    , completedBytes_(0)
+    , completedEof_(false)
+    , completedErrno_(0)
 {
      // 下面给channel设置相应的回调函数 poller给channel通知感兴趣的事件发生了 channel会回调相应的回调函数
-    channel_->setReadCallback(
+    channel_.setReadCallback(
         std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
-    channel_->setWriteCallback(
+    channel_.setWriteCallback(
         std::bind(&TcpConnection::handleWrite, this));
-    channel_->setCloseCallback(
+    channel_.setCloseCallback(
         std::bind(&TcpConnection::handleClose, this));
-    channel_->setErrorCallback(
+    channel_.setErrorCallback(
         std::bind(&TcpConnection::handleError, this));
+    // io_uring 后端用 multishot recv 代替每次可读一次 readv
+    channel_.setReadMode(Channel::kReadRecv);
+    channel_.setCompletionCallback(
+        std::bind(&TcpConnection::handleRecvCompletion, this, std::placeholders::_1, std::placeholders::_2));
 
-    LOG_INFO("TcpConnection::create[ %s ] at fd = %d " , name_.c_str() , sockfd) ;
-    socket_->setKeepAlive(true);
+    LOG_INFO("TcpConnection::create from %s at fd = %d " , peerAddr_.toIpPort().c_str() , sockfd) ;
 }
 
 TcpConnection::~TcpConnection()
 {
-    LOG_INFO("TcpConnection::delete[ %s ] at fd = %d " , name_.c_str() , channel_->fd()) ; 
+    LOG_INFO("TcpConnection::delete[ %s ] at fd = %d " , name().c_str() , channel_.fd()) ; 
+}
+
+std::string TcpConnection::name() const
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "#%u.%u.%u", ConnectionRegistry::shardOf(id_),
+             ConnectionRegistry::slotOf(id_), ConnectionRegistry::generationOf(id_));
+    return *namePrefix_ + buf;
 }
 
 // 发送数据
@@ -96,13 +130,57 @@ void TcpConnection::send(Buffer *buf)
     }
 }
 
+void TcpConnection::send(const std::shared_ptr<const char> &holder, const char *data, size_t len)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendInLoop(holder, data, len);
+        }
+        else
+        {
+            void (TcpConnection::*fp)(const std::shared_ptr<const char>&, const char*, size_t) = &TcpConnection::sendInLoop;
+            loop_->runInLoop(std::bind(fp, shared_from_this(), holder, data, len));
+        }
+    }
+}
+
+void TcpConnection::sendFile(int fd, off_t offset, size_t len)
+{
+    if (state_ == kConnected)
+    {
+        // 在调用方线程中 dup ，调用方返回后就可以关闭自己的 fd
+        int fileFd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        if (fileFd < 0)
+        {
+            LOG_ERROR("TcpConnection::sendFile dup fd %d failed: %d", fd, errno);
+            return;
+        }
+        if (loop_->isInLoopThread())
+        {
+            sendFileInLoop(fileFd, offset, len);
+        }
+        else
+        {
+            loop_->queueInLoop(std::bind(
+                &TcpConnection::sendFileInLoop, shared_from_this(), fileFd, offset, len));
+        }
+    }
+}
+
 void TcpConnection::sendInLoop(const std::string& message)
 {
     sendInLoop(message.data(), message.size());
 }
 
-// 发送数据 应用写的快 而内核发送数据慢 需要把待发送数据写入缓冲区，故设置了水位回调
 void TcpConnection::sendInLoop(const void* data, size_t len)
+{
+    sendInLoop(std::shared_ptr<const char>(), static_cast<const char*>(data), len);
+}
+
+// 发送数据 应用写的快 而内核发送数据慢 需要把待发送数据写入缓冲区，故设置了水位回调
+void TcpConnection::sendInLoop(const std::shared_ptr<const char> &holder, const char *data, size_t len)
 {
     ssize_t nwrote = 0;
     size_t remaining = len; 
@@ -115,10 +193,20 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
         return ;
     }
 
+    // 零拷贝发送的内存块要留在发送队列中等待完成通知，不能直接 write
+    size_t zeroCopyThreshold = outputQueue_.zeroCopyThreshold();
+    if (holder && zeroCopyThreshold > 0 && len >= zeroCopyThreshold)
+    {
+        size_t oldLen = outputQueue_.readableBytes();
+        outputQueue_.append(holder, data, len);
+        writeQueuedInLoop(oldLen, len);
+        return ;
+    }
+
     // channel第一次写数据，且缓冲区没有待发送数据
-    if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+    if (!outputPending() && outputQueue_.empty())
     {
-        nwrote = ::write(channel_->fd(), data, len);
+        nwrote = ::write(channel_.fd(), data, len);
         if (nwrote >= 0)
         {
             // 判断有没有一次性写完
@@ -149,7 +237,7 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
     // 说明一次性并没有发送完数据，剩余数据需要保存到缓冲区中，且需要改channel注册监听写事件
     if (!faultError && remaining > 0)
     {
-        size_t oldLen = outputBuffer_.readableBytes();
+        size_t oldLen = outputQueue_.readableBytes();
         if (oldLen + remaining >= highWaterMark_ 
         && oldLen < highWaterMark_ 
         && highWaterMarkCallback_)
@@ -158,13 +246,77 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
             loop_->queueInLoop(std::bind(
                 highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
         }
-        outputBuffer_.append((char *)data + nwrote, remaining);
-        if (!channel_->isWriting())
+        if (holder)
+        {
+            outputQueue_.append(holder, data + nwrote, remaining);
+        }
+        else
+        {
+            outputQueue_.append(data + nwrote, remaining);
+        }
+        // 边缘触发模式下 EPOLLOUT 一直是注册状态
+        if (!edgeTriggered_ && !channel_.isWriting())
         {
             // 这里一定要注册channel的写事件 否则当文件描述符 fd 可写时，epoller 不会给 channel 通知执行可写的回调函数
-            channel_->enableWriting(); 
+            channel_.enableWriting(); 
+        }
+        checkBackpressure();
+    }
+}
+
+void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t len)
+{
+    if (state_ == kDisconnected || len == 0)
+    {
+        if (len > 0)
+        {
+            LOG_ERROR("disconnected, give up sending file") ;
+        }
+        ::close(fd);
+        return ;
+    }
+
+    size_t oldLen = outputQueue_.readableBytes();
+    outputQueue_.appendFile(fd, offset, len);
+    writeQueuedInLoop(oldLen, len);
+}
+
+void TcpConnection::writeQueuedInLoop(size_t oldLen, size_t len)
+{
+    if (oldLen + len >= highWaterMark_ 
+        && oldLen < highWaterMark_ 
+        && highWaterMarkCallback_)
+    {
+        loop_->queueInLoop(std::bind(
+            highWaterMarkCallback_, shared_from_this(), oldLen + len));
+    }
+
+    // 前面没有等待发送的数据，直接发送一次
+    if (oldLen == 0 && !outputPending())
+    {
+        int saveErrno = 0;
+        ssize_t n = outputQueue_.writeFd(channel_.fd(), &saveErrno);
+        if (n < 0 && saveErrno != EAGAIN && saveErrno != EWOULDBLOCK)
+        {
+            LOG_ERROR("TcpConnection::writeQueuedInLoop , maybe peer already close");
+        }
+        else if (outputQueue_.empty())
+        {
+            if (writeCompleteCallback_)
+            {
+                loop_->queueInLoop(
+                    std::bind(writeCompleteCallback_, shared_from_this()));
+            }
+            checkBackpressure();
+            return ;
         }
     }
+
+    if (!outputQueue_.empty() && !edgeTriggered_ && !channel_.isWriting())
+    {
+        channel_.enableWriting();
+    }
+    checkBackpressure();
 }
 
 // 关闭连接 
@@ -180,10 +332,182 @@ void TcpConnection::shutdown()
 
 void TcpConnection::shutdownInLoop()
 {
-    // 说明当前 outputBuffer_ 的数据全部向外发送完成
-    if (!channel_->isWriting()) 
+    // 说明当前 outputQueue_ 的数据全部向外发送完成
+    if (!outputPending()) 
+    {
+        socket_.shutdownWrite();
+    }
+}
+
+// 强制关闭连接，走和对端关闭一样的 handleClose 流程
+void TcpConnection::forceClose()
+{
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        setState(kDisconnecting);
+        // 和之前投递的 send 等普通回调保持顺序，不能用 kControl 插到它们前面
+        loop_->queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+    }
+}
+
+void TcpConnection::forceCloseInLoop()
+{
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        handleClose();
+    }
+}
+
+void TcpConnection::startRead()
+{
+    loop_->runInLoop(std::bind(&TcpConnection::startReadInLoop, shared_from_this()));
+}
+
+void TcpConnection::startReadInLoop()
+{
+    // 还没有建立或者已经关闭的连接不能注册到 Poller 上
+    if (state_ != kConnected && state_ != kDisconnecting)
+    {
+        return ;
+    }
+    if (!reading_ || !channel_.isReading())
+    {
+        // 边缘触发模式下重新注册 EPOLLIN 时，内核会检查已经到达的数据，不会丢失可读通知
+        channel_.enableReading();
+        reading_ = true;
+        // 暂停时 Poller 已经收到的数据不会再有读事件，直接交给上层
+        if (completedBytes_ > 0 || completedEof_ || completedErrno_ != 0)
+        {
+            loop_->queueInLoop(
+                std::bind(&TcpConnection::handleCompletedReads, shared_from_this(), Timestamp::now()));
+        }
+    }
+}
+
+void TcpConnection::stopRead()
+{
+    loop_->runInLoop(std::bind(&TcpConnection::stopReadInLoop, shared_from_this()));
+}
+
+void TcpConnection::stopReadInLoop()
+{
+    if (state_ != kConnected && state_ != kDisconnecting)
+    {
+        return ;
+    }
+    if (reading_ || channel_.isReading())
+    {
+        channel_.disableReading();
+        reading_ = false;
+    }
+}
+
+void TcpConnection::setSocketOptions(const SocketOptions &options)
+{
+    if (options.tcpNoDelay)
+    {
+        socket_.setTcpNoDelay(true);
+    }
+    if (options.keepAlive)
+    {
+        socket_.setKeepAlive(true);
+    }
+    if (options.busyPollMicros > 0 && !socket_.setBusyPoll(options.busyPollMicros))
+    {
+        LOG_DEBUG("TcpConnection set SO_BUSY_POLL failed, errno = %d", errno);
+    }
+}
+
+void TcpConnection::setCork(bool on)
+{
+    if (loop_->isInLoopThread())
+    {
+        setCorkInLoop(on);
+    }
+    else
+    {
+        loop_->runInLoop(std::bind(&TcpConnection::setCorkInLoop, shared_from_this(), on));
+    }
+}
+
+void TcpConnection::setCorkInLoop(bool on)
+{
+    if (state_ == kDisconnected)
+    {
+        return ;
+    }
+    if (!socket_.setCork(on))
+    {
+        LOG_DEBUG("TcpConnection [ %s ] set TCP_CORK failed, errno = %d", name().c_str(), errno);
+    }
+}
+
+void TcpConnection::checkBackpressure()
+{
+    if (backpressureHigh_ == 0)
+    {
+        return ;
+    }
+    size_t pending = outputQueue_.readableBytes();
+    if (!backpressured_ && pending > backpressureHigh_)
+    {
+        backpressured_ = true;
+        LOG_DEBUG("TcpConnection [ %s ] output backlog %zu bytes, pause reading", name().c_str(), pending);
+        TcpConnectionPtr source = backpressureSource_.lock();
+        if (source)
+        {
+            source->stopRead();
+        }
+        if (evictSeconds_ > 0)
+        {
+            evictTimer_ = loop_->runAfter(evictSeconds_,
+                std::bind(&TcpConnection::evictIfStalled, std::weak_ptr<TcpConnection>(shared_from_this())));
+        }
+    }
+    else if (backpressured_ && pending <= backpressureLow_)
+    {
+        LOG_DEBUG("TcpConnection [ %s ] output backlog %zu bytes, resume reading", name().c_str(), pending);
+        resumeBackpressureSource();
+    }
+}
+
+void TcpConnection::resumeBackpressureSource()
+{
+    backpressured_ = false;
+    if (evictSeconds_ > 0)
     {
-        socket_->shutdownWrite();
+        loop_->cancel(evictTimer_);
+    }
+    TcpConnectionPtr source = backpressureSource_.lock();
+    if (source)
+    {
+        source->startRead();
+    }
+}
+
+void TcpConnection::evictIfStalled(const std::weak_ptr<TcpConnection> &weakConn)
+{
+    TcpConnectionPtr conn(weakConn.lock());
+    if (conn && conn->backpressured_ && conn->connected())
+    {
+        LOG_WARN("TcpConnection [ %s ] output backlog %zu bytes for %.1f seconds, evicted",
+                 conn->name().c_str(), conn->outputQueue_.readableBytes(), conn->evictSeconds_);
+        conn->forceClose();
+    }
+}
+
+void TcpConnection::setZeroCopy(size_t threshold)
+{
+    if (threshold > 0 && !socket_.setZeroCopy(true))
+    {
+        LOG_ERROR("TcpConnection::setZeroCopy [%s] SO_ZEROCOPY failed: %d", name().c_str(), errno);
+        threshold = 0;
+    }
+    outputQueue_.setZeroCopyThreshold(threshold);
+    if (threshold > 0)
+    {
+        // 零拷贝的完成通知通过 EPOLLERR 返回，需要一直 poll 这个 fd ，不使用 multishot recv
+        channel_.setReadMode(Channel::kReadReadiness);
     }
 }
 
@@ -191,10 +515,25 @@ void TcpConnection::shutdownInLoop()
 void TcpConnection::connectEstablished()
 {
     setState(kConnected); // 建立连接，设置一开始状态为连接态
+    lastActiveTime_ = Timestamp::now();
     // tie 防止 channel 在执行回调函数的时候，TcpConnection 已经被删除了
-    channel_->tie(shared_from_this());
-    // 向 epoller 注册 channel 的EPOLLIN读事件
-    channel_->enableReading(); 
+    channel_.tie(shared_from_this());
+    // 没有设置背压源时暂停读取自己
+    if (backpressureSource_.expired())
+    {
+        backpressureSource_ = shared_from_this();
+    }
+    if (edgeTriggered_)
+    {
+        // 边缘触发模式一次性注册读写事件，之后不再修改
+        channel_.setEdgeTriggered(true);
+        channel_.enableReadingAndWriting();
+    }
+    else
+    {
+        // 向 epoller 注册 channel 的EPOLLIN读事件
+        channel_.enableReading(); 
+    }
     // 新连接建立 执行回调
     connectionCallback_(shared_from_this());
 }
@@ -206,20 +545,39 @@ void TcpConnection::connectDestroyed()
     {
         setState(kDisconnected);
         // 把 channel 的所有感兴趣的事件从 epoller 中删除掉
-        channel_->disableAll(); 
+        channel_.disableAll(); 
         connectionCallback_(shared_from_this());
     }
-    channel_->remove(); // 把 channel 从 epoller 中删除掉
+    channel_.remove(); // 把 channel 从 epoller 中删除掉
+    // 析构可能发生在其他线程，在 loop 线程中把缓冲区还给 BufferPool
+    if (inputBuffer_)
+    {
+        loop_->bufferPool()->release(std::move(inputBuffer_));
+    }
 }
 
 void TcpConnection::handleRead(Timestamp receiveTime)
 {
+    if (channel_.completionReads())
+    {
+        handleCompletedReads(receiveTime);
+        return ;
+    }
+    if (edgeTriggered_)
+    {
+        handleReadEdgeTriggered(receiveTime);
+        return ;
+    }
+
     int savedErrno = 0 ; 
-    ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+    acquireInputBuffer();
+    ssize_t n = inputBuffer_->readFd(channel_.fd(), &savedErrno);
     if (n > 0)
     {
+        updateReadSizeHint(n);
+        lastActiveTime_ = receiveTime;
         // 已建立连接的用户，有可读事件发生，调用用户传入的回调操作
-        messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+        messageCallback_(shared_from_this(), inputBuffer_.get(), receiveTime);
     }
     else if (n == 0)
     {
@@ -233,21 +591,84 @@ void TcpConnection::handleRead(Timestamp receiveTime)
         LOG_ERROR("TcpConnection::handleRead() failed") ;
         handleError();
     }
+    releaseInputBuffer();
+}
+
+void TcpConnection::handleRecvCompletion(int res, const char *data)
+{
+    if (res > 0)
+    {
+        if (!inputBuffer_)
+        {
+            inputBuffer_ = loop_->bufferPool()->acquire();
+        }
+        inputBuffer_->append(data, res);
+        completedBytes_ += res;
+    }
+    else if (res == 0)
+    {
+        completedEof_ = true;
+    }
+    else
+    {
+        completedErrno_ = -res;
+    }
+}
+
+void TcpConnection::handleCompletedReads(Timestamp receiveTime)
+{
+    // stopRead 之后、取消生效之前收到的数据留在接收缓冲区中，恢复读取时再交给上层
+    if (state_ == kDisconnected || !reading_)
+    {
+        return ;
+    }
+
+    if (completedBytes_ > 0)
+    {
+        completedBytes_ = 0;
+        lastActiveTime_ = receiveTime;
+        messageCallback_(shared_from_this(), inputBuffer_.get(), receiveTime);
+    }
+    releaseInputBuffer();
+
+    // 用户回调中可能已经关闭了连接
+    if (state_ == kDisconnected)
+    {
+        return ;
+    }
+    if (completedEof_)
+    {
+        completedEof_ = false;
+        handleClose();
+    }
+    else if (completedErrno_ != 0)
+    {
+        errno = completedErrno_;
+        completedErrno_ = 0;
+        LOG_ERROR("TcpConnection::handleCompletedReads() failed") ;
+        handleError();
+    }
 }
 
 void TcpConnection::handleWrite()
 {
-    if (channel_->isWriting())
+    if (edgeTriggered_)
+    {
+        handleWriteEdgeTriggered();
+        return ;
+    }
+
+    if (channel_.isWriting())
     {
         int saveErrno = 0;
-        ssize_t n = outputBuffer_.writeFd(channel_->fd(), &saveErrno);
-        // 正确读取数据
-        if (n > 0)
+        ssize_t n = outputQueue_.writeFd(channel_.fd(), &saveErrno);
+        // 正确读取数据，被截断的文件丢弃之后可能没有发送任何数据但队列已经空了
+        if (n >= 0)
         {
-            outputBuffer_.retrieve(n) ; 
-            if (outputBuffer_.readableBytes() == 0)
+            checkBackpressure();
+            if (outputQueue_.empty())
             {
-                channel_->disableWriting() ;
+                channel_.disableWriting() ;
                 // 调用用户自定义的写完数据处理函数
                 if (writeCompleteCallback_)
                 {
@@ -268,32 +689,202 @@ void TcpConnection::handleWrite()
     }
     else // state_不为写状态
     {
-        LOG_ERROR("TcpConnection fd= %d  is down, no more writing " , channel_->fd());
+        LOG_ERROR("TcpConnection fd= %d  is down, no more writing " , channel_.fd());
+    }
+}
+
+// 边缘触发模式下必须一直读到 EAGAIN ，否则剩下的数据不会再有可读通知
+void TcpConnection::handleReadEdgeTriggered(Timestamp receiveTime)
+{
+    // stopRead 之后之前放入回调队列的继续读取也要停下
+    if (state_ == kDisconnected || !reading_)
+    {
+        return ;
+    }
+
+    size_t total = 0 ;
+    bool peerClosed = false ;
+    int savedErrno = 0 ;
+    ssize_t n = 0 ;
+    acquireInputBuffer();
+    while (total < maxBytesPerRound_)
+    {
+        n = inputBuffer_->readFd(channel_.fd(), &savedErrno);
+        if (n > 0)
+        {
+            total += n ;
+            updateReadSizeHint(n);
+        }
+        else
+        {
+            peerClosed = (n == 0) ;
+            break ;
+        }
+    }
+
+    if (total > 0)
+    {
+        lastActiveTime_ = receiveTime;
+        messageCallback_(shared_from_this(), inputBuffer_.get(), receiveTime);
+    }
+    releaseInputBuffer();
+
+    if (peerClosed)
+    {
+        // 用户回调中可能已经关闭了连接
+        if (state_ != kDisconnected)
+        {
+            handleClose();
+        }
+    }
+    else if (total >= maxBytesPerRound_)
+    {
+        // 达到一轮的读取上限，可能还有数据没读完，放到回调队列中，先处理完其他连接再继续读
+        if (state_ != kDisconnected)
+        {
+            loop_->queueInLoop(
+                std::bind(&TcpConnection::handleReadEdgeTriggered, shared_from_this(), receiveTime));
+        }
+    }
+    else if (savedErrno != EAGAIN && savedErrno != EWOULDBLOCK)
+    {
+        errno = savedErrno;
+        LOG_ERROR("TcpConnection::handleReadEdgeTriggered() failed") ;
+        handleError();
+    }
+}
+
+// 边缘触发模式下写到 EAGAIN 或者发送缓冲区清空为止，EPOLLOUT 不需要注销
+void TcpConnection::handleWriteEdgeTriggered()
+{
+    if (state_ == kDisconnected)
+    {
+        return ;
+    }
+
+    size_t total = 0 ;
+    int saveErrno = 0 ;
+    // EPOLLOUT 一直处于注册状态，可读事件返回时也会带上 EPOLLOUT ，缓冲区为空时直接跳过
+    while (!outputQueue_.empty() && total < maxBytesPerRound_)
+    {
+        ssize_t n = outputQueue_.writeFd(channel_.fd(), &saveErrno);
+        if (n > 0)
+        {
+            total += n ;
+        }
+        else
+        {
+            if (saveErrno != EAGAIN && saveErrno != EWOULDBLOCK)
+            {
+                LOG_ERROR("TcpConnection::handleWriteEdgeTriggered() failed");
+            }
+            break ;
+        }
+    }
+
+    if (total == 0)
+    {
+        return ;
+    }
+    checkBackpressure();
+
+    if (outputQueue_.empty())
+    {
+        if (writeCompleteCallback_)
+        {
+            loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+        }
+        if (state_ == kDisconnecting)
+        {
+            shutdownInLoop();
+        }
+    }
+    else if (total >= maxBytesPerRound_)
+    {
+        // 达到一轮的发送上限，socket 可能仍然可写，不会再有 EPOLLOUT 通知，放到回调队列中稍后继续发送
+        loop_->queueInLoop(
+            std::bind(&TcpConnection::handleWriteEdgeTriggered, shared_from_this()));
     }
 }
 
 void TcpConnection::handleClose()
 {
     setState(kDisconnected);    // 设置状态为关闭连接状态
-    channel_->disableAll();     // 注销Channel所有感兴趣事件
+    channel_.disableAll();     // 注销Channel所有感兴趣事件
+    // 下游关闭之后恢复上游的读取，背压源是自己时已经是关闭状态，不会再注册
+    if (backpressured_)
+    {
+        resumeBackpressureSource();
+    }
 
     // 继续增加一个引用计数的智能指针，防止 TcpConnectionPtr 计数减到零析构，无法执行下面的回调函数 
     TcpConnectionPtr connPtr(shared_from_this());
     connectionCallback_(connPtr); // 用户设置的断开连接的回调函数
     // TcpServe 设置的关闭链接时的回调函数 
-    // 因为还要在总的 TcpServer 中函数对应的 ConnectionMap 指向的 TcpConnection 对象
+    // 在当前 loop 中把连接从 TcpServer 中该 loop 的连接分片里移除
     // 然后再调用 TcpConnection 中的 connectDestroyed 函数删除 Epoller 监听的 Channel 事件
     closeCallback_(connPtr);      
     // 最后 TcpConnection 析构，因为成员变量都是智能指针的形式，故都会执行对应的析构
 
 }
 
+bool TcpConnection::outputPending() const
+{
+    // 边缘触发模式下 EPOLLOUT 一直是注册状态，只能通过发送缓冲区判断
+    return edgeTriggered_ ? !outputQueue_.empty() : channel_.isWriting();
+}
+
+void TcpConnection::acquireInputBuffer()
+{
+    if (!inputBuffer_)
+    {
+        inputBuffer_ = loop_->bufferPool()->acquire();
+    }
+    inputBuffer_->ensureWritableBytes(readSizeHint_);
+}
+
+void TcpConnection::releaseInputBuffer()
+{
+    if (inputBuffer_ && inputBuffer_->readableBytes() == 0)
+    {
+        loop_->bufferPool()->release(std::move(inputBuffer_));
+    }
+}
+
+void TcpConnection::updateReadSizeHint(size_t n)
+{
+    if (n >= readSizeHint_)
+    {
+        readSizeHint_ = std::min(readSizeHint_ * 2, kMaxReadSize);
+        smallReads_ = 0;
+    }
+    else if (n <= readSizeHint_ / 2 && readSizeHint_ > kMinReadSize)
+    {
+        if (++smallReads_ >= 2)
+        {
+            readSizeHint_ /= 2;
+            smallReads_ = 0;
+        }
+    }
+    else
+    {
+        smallReads_ = 0;
+    }
+}
+
 void TcpConnection::handleError()
 {
+    // 零拷贝发送的完成通知通过错误队列返回，同样触发 EPOLLERR ，只有通知时不是真正的错误
+    int completions = 0;
+    if (outputQueue_.zeroCopyThreshold() > 0)
+    {
+        completions = outputQueue_.handleZeroCopyCompletions(channel_.fd());
+    }
+
     int optval;
     socklen_t optlen = sizeof(optval);
     int err = 0 ; 
-    if (::getsockopt(channel_->fd(), SOL_SOCKET, SO_ERROR, &optval, &optlen))
+    if (::getsockopt(channel_.fd(), SOL_SOCKET, SO_ERROR, &optval, &optlen))
     {
         err = errno;
     }
@@ -301,5 +892,9 @@ void TcpConnection::handleError()
     {
         err = optval;
     }
-    LOG_ERROR("cpConnection::handleError name: %s  - SO_ERROR: %d ", name_.c_str() , err) ;
+    if (err == 0 && completions > 0)
+    {
+        return ;
+    }
+    LOG_ERROR("cpConnection::handleError name: %s  - SO_ERROR: %d ", name().c_str() , err) ;
 }
\ No newline at end of file
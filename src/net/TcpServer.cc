@@ -2,6 +2,9 @@
 #include "./net/TcpConnection.h"
 #include "./log/Logging.h"
 
+#include <fcntl.h>
+#include <future>
+
 // 检查用户传入的 baseLoop 指针是否有意义
 static EventLoop *CheckLoopNotNull(EventLoop *loop)
 {
@@ -12,38 +15,89 @@ static EventLoop *CheckLoopNotNull(EventLoop *loop)
     return loop;
 }
 
+// Acceptor 的 Channel 只能在所属 loop 的线程中从 Poller 上移除，其他线程需要等待该 loop 执行完成
+static void destroyAcceptorInLoop(EventLoop *loop, std::unique_ptr<Acceptor> &acceptor)
+{
+    if (loop->isInLoopThread())
+    {
+        acceptor.reset();
+        return;
+    }
+    std::promise<void> done;
+    loop->runInLoop([&acceptor, &done]() {
+        acceptor.reset();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
 TcpServer::TcpServer(EventLoop *loop,
                      const InetAddress &listenAddr,
                      const std::string &nameArg,
                      Option option)
     : loop_(CheckLoopNotNull(loop)),
+    listenAddr_(listenAddr),
     ipPort_(listenAddr.toIpPort()),
     name_(nameArg),
+    namePrefix_(std::make_shared<const std::string>(nameArg + "-" + ipPort_)),
     acceptor_(new Acceptor(loop, listenAddr, option == kReusePort)),
+    acceptMode_(kSingleAcceptor),
     threadPool_(new EventLoopThreadPool(loop, name_)),
     connectionCallback_(),
     messageCallback_(),
     writeCompleteCallback_(),
+    highWaterMarkCallback_(),
+    highWaterMark_(64 * 1024 * 1024),
     threadInitCallback_(),
     started_(0),
-    nextConnId_(1)    
+    numConnections_(0),
+    maxConnections_(0),
+    maxAcceptsPerRound_(Acceptor::kDefaultMaxAcceptsPerRound),
+    idleTimeout_(0),
+    edgeTriggered_(false),
+    maxBytesPerRound_(TcpConnection::kDefaultMaxBytesPerRound),
+    zeroCopyThreshold_(0),
+    busyPollMicros_(0),
+    roundMaxChannels_(0),
+    roundMaxFunctors_(0),
+    roundBudgetMicros_(0),
+    backpressureHigh_(0),
+    backpressureLow_(0),
+    evictSeconds_(0)
 {
     // 当有新用户连接时，Acceptor类中绑定的acceptChannel_会有读事件发生执行handleRead()调用TcpServer::newConnection回调
     acceptor_->setNewConnectionCallback(
         std::bind(&TcpServer::newConnection, this, std::placeholders::_1, std::placeholders::_2));
+    acceptor_->setAdmissionCallback(std::bind(&TcpServer::admitConnection, this));
 }
 
 TcpServer::~TcpServer()
 {
-    for(auto &item : connections_)
+    // 先停止各个 loop 上的监听，此时 subLoop 线程还在运行
+    if (!loopAcceptors_.empty())
     {
-        // 非常巧妙的一个方式，就把 TcpConnection 对象给释放了
-        TcpConnectionPtr conn(item.second);
-        // 把原始的智能指针复位 让栈空间的TcpConnectionPtr conn指向该对象 当conn出了其作用域 即可释放智能指针指向的对象
-        item.second.reset();    
-        // 销毁连接
-        conn->getLoop()->runInLoop(
-            std::bind(&TcpConnection::connectDestroyed, conn));
+        std::vector<EventLoop*> loops = threadPool_->getAllLoops();
+        for (size_t i = 0; i < loopAcceptors_.size(); ++i)
+        {
+            destroyAcceptorInLoop(loops[i], loopAcceptors_[i]);
+        }
+    }
+
+    // 只有这里需要遍历所有分片，各个 loop 仍在运行，取出之后同一时间关闭的连接在 removeConnection 中找不到自己，不会重复销毁
+    for (std::unique_ptr<ConnectionShard> &shard : shards_)
+    {
+        std::vector<TcpConnectionPtr> conns;
+        {
+            std::unique_lock<std::mutex> lock(shard->mutex);
+            conns = shard->registry.takeAll();
+        }
+        for (TcpConnectionPtr &conn : conns)
+        {
+            // 销毁连接，connectDestroyed 执行完之后 TcpConnection 析构，内存还给所在 loop 的 slab
+            conn->getLoop()->runInLoop(
+                std::bind(&TcpConnection::connectDestroyed, conn), EventLoop::kControl);
+            conn.reset();
+        }
     }
 }
 
@@ -60,27 +114,139 @@ void TcpServer::start()
     {
         // 启动底层的lopp线程池
         threadPool_->start(threadInitCallback_);
-        // bind 绑定类方法的时候需要 acceptor_.get() 地址
-        loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+        std::vector<EventLoop*> loops = threadPool_->getAllLoops();
+        if (loops.size() > ConnectionRegistry::kMaxShards)
+        {
+            LOG_FATAL("TcpServer::start [ %s ] too many loops: %zu", name_.c_str(), loops.size());
+        }
+        for (size_t i = 0; i < loops.size(); ++i)
+        {
+            shards_.emplace_back(new ConnectionShard(static_cast<uint32_t>(i)));
+            loopShards_[loops[i]] = shards_.back().get();
+        }
+        for (EventLoop *ioLoop : loops)
+        {
+            if (busyPollMicros_ > 0)
+            {
+                ioLoop->setBusyPoll(busyPollMicros_);
+            }
+            if (roundMaxChannels_ > 0 || roundMaxFunctors_ > 0 || roundBudgetMicros_ > 0)
+            {
+                ioLoop->setRoundBudget(roundMaxChannels_, roundMaxFunctors_, roundBudgetMicros_);
+            }
+        }
+        // 每个 loop 创建一个时间轮，在各自的线程中检测空闲连接
+        if (idleTimeout_ > 0)
+        {
+            for (EventLoop *ioLoop : threadPool_->getAllLoops())
+            {
+                std::shared_ptr<TimingWheel> wheel(new TimingWheel(ioLoop, idleTimeout_));
+                wheel->start();
+                timingWheels_[ioLoop] = wheel;
+            }
+        }
+        // Unix 域地址没有 SO_REUSEPORT ，一个路径只能 bind 一次，退回到 mainLoop 上单个 Acceptor
+        if (acceptMode_ == kReusePortPerLoop && listenAddr_.family() == AF_UNIX)
+        {
+            LOG_WARN("TcpServer::start [ %s ] kReusePortPerLoop is not supported for unix domain address %s, use kSingleAcceptor",
+                     name_.c_str(), listenAddr_.toIpPort().c_str());
+            acceptMode_ = kSingleAcceptor;
+        }
+        if (acceptMode_ == kSingleAcceptor)
+        {
+            acceptor_->setMaxAcceptsPerRound(maxAcceptsPerRound_);
+            acceptor_->setSocketOptions(socketOptions_);
+            // bind 绑定类方法的时候需要 acceptor_.get() 地址
+            loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+        }
+        else
+        {
+            startLoopAcceptors();
+        }
+    }
+}
+
+void TcpServer::startLoopAcceptors()
+{
+    int sharedfd = -1;
+    if (acceptMode_ == kExclusiveShared)
+    {
+        // 共享构造函数中已经 bind 好的监听 socket ，每个 loop 持有一个 dup 出来的 fd ，各自关闭互不影响
+        sharedfd = acceptor_->fd();
+    }
+    else
+    {
+        // mainLoop 上的 socket 可能没有设置 SO_REUSEPORT ，先关闭它再让每个 loop 重新 bind
+        acceptor_.reset();
+    }
+
+    for (EventLoop *ioLoop : threadPool_->getAllLoops())
+    {
+        Acceptor *acceptor = nullptr;
+        if (acceptMode_ == kReusePortPerLoop)
+        {
+            acceptor = new Acceptor(ioLoop, listenAddr_, true);
+        }
+        else
+        {
+            int listenfd = ::fcntl(sharedfd, F_DUPFD_CLOEXEC, 0);
+            if (listenfd < 0)
+            {
+                LOG_FATAL("dup listen socket err %d", errno);
+            }
+            acceptor = new Acceptor(ioLoop, listenfd, true);
+        }
+        acceptor->setNewConnectionCallback(
+            std::bind(&TcpServer::newConnectionInLoop, this, ioLoop, std::placeholders::_1, std::placeholders::_2));
+        acceptor->setAdmissionCallback(std::bind(&TcpServer::admitConnection, this));
+        acceptor->setMaxAcceptsPerRound(maxAcceptsPerRound_);
+        acceptor->setSocketOptions(socketOptions_);
+        loopAcceptors_.emplace_back(acceptor);
+        // Channel 要在所属 loop 的线程中注册到 Poller 上
+        ioLoop->runInLoop(std::bind(&Acceptor::listen, acceptor));
+    }
+
+    // 监听 socket 已经交给各个 loop ，mainLoop 上的 Acceptor 不再需要
+    acceptor_.reset();
+}
+
+bool TcpServer::admitConnection() const
+{
+    int maxConnections = maxConnections_.load();
+    return maxConnections <= 0 || numConnections_.load() < maxConnections;
+}
+
+TcpServer::AcceptStats TcpServer::acceptStats() const
+{
+    AcceptStats stats = {0, 0, 0};
+    if (acceptor_)
+    {
+        stats.accepted += acceptor_->acceptedCount();
+        stats.shed += acceptor_->shedCount();
+        stats.emfile += acceptor_->emfileCount();
+    }
+    for (const std::unique_ptr<Acceptor> &acceptor : loopAcceptors_)
+    {
+        stats.accepted += acceptor->acceptedCount();
+        stats.shed += acceptor->shedCount();
+        stats.emfile += acceptor->emfileCount();
     }
+    return stats;
 }
 
 // 有一个新用户连接，acceptor会执行这个回调操作，负责将mainLoop接收到的请求连接(acceptChannel_会有读事件发生)通过回调轮询分发给subLoop去处理
 void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
 {
-    // 轮询算法 选择一个subLoop 来管理connfd对应的channel
-    EventLoop *ioLoop = threadPool_->getNextLoop();
-    char buf[64] = {0};
-    snprintf(buf, sizeof(buf), "-%s#%d", ipPort_.c_str(), nextConnId_);
-    
-    // 这里没有设置为原子类是因为其只在mainloop中执行 不涉及线程安全问题
-    ++nextConnId_;  
-    // 新连接名字
-    std::string connName = name_ + buf;
-    LOG_INFO("TcpServer::newConnection [ %s ] - new connection [ %s ] from %s", name_.c_str() , connName.c_str(), peerAddr.toIpPort().c_str()) ;
-    
+    // 按照设置的策略(默认轮询)选择一个subLoop 来管理connfd对应的channel
+    EventLoop *ioLoop = threadPool_->getLoopForPeer(peerAddr);
+    newConnectionInLoop(ioLoop, sockfd, peerAddr);
+}
+
+// 单个 Acceptor 时在 mainLoop 中调用，每个 loop 独立监听时在接收连接的 loop 中直接调用
+void TcpServer::newConnectionInLoop(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr)
+{
     // 通过sockfd获取其绑定的本机的ip地址和端口信息
-    sockaddr_in local;
+    sockaddr_storage local;
     ::memset(&local, 0, sizeof(local));
     socklen_t addrlen = sizeof(local);
     if(::getsockname(sockfd, (sockaddr *)&local, &addrlen) < 0)
@@ -88,37 +254,83 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
         LOG_ERROR("sockets::getLocalAddr() failed") ;
     }
 
-    InetAddress localAddr(local) ;
-    TcpConnectionPtr conn(new TcpConnection(ioLoop,
-                                            connName,
-                                            sockfd,
-                                            localAddr,
-                                            peerAddr)) ;
-    connections_[connName] = conn;
+    InetAddress localAddr((sockaddr *)&local, addrlen) ;
+    // start 之后 loopShards_ 只读，可以在多个 loop 中同时查找
+    ConnectionShard *shard = loopShards_.find(ioLoop)->second;
+    SlabAllocator<TcpConnection> alloc(shard->slab);
+    TcpConnectionPtr conn = std::allocate_shared<TcpConnection>(alloc,
+                                                                ioLoop,
+                                                                namePrefix_,
+                                                                sockfd,
+                                                                localAddr,
+                                                                peerAddr);
+    {
+        // 单个 Acceptor 时在 mainLoop 中加入 ioLoop 的分片，其他模式下就是在 ioLoop 中
+        std::unique_lock<std::mutex> lock(shard->mutex);
+        conn->setId(shard->registry.add(conn));
+    }
+    LOG_INFO("TcpServer::newConnection [ %s ] - new connection [ %s ] from %s", name_.c_str() , conn->name().c_str(), peerAddr.toIpPort().c_str()) ;
+    ++numConnections_;
+    ioLoop->addConnectionCount(1);
 
     // 下面三个回调函数都是用户设置给TcpServer => TcpConnection => Channel 
     conn->setConnectionCallback(connectionCallback_);
     conn->setMessageCallback(messageCallback_);
     conn->setWriteCompleteCallback(writeCompleteCallback_);
+    conn->setEdgeTriggered(edgeTriggered_, maxBytesPerRound_);
+    conn->setSocketOptions(socketOptions_);
+    if (zeroCopyThreshold_ > 0)
+    {
+        conn->setZeroCopy(zeroCopyThreshold_);
+    }
+    if (highWaterMarkCallback_)
+    {
+        conn->setHighWaterMarkCallback(highWaterMarkCallback_, highWaterMark_);
+    }
+    conn->setBackpressure(backpressureHigh_, backpressureLow_, evictSeconds_);
     // 设置 TcpConnection 对应的断开连接回调函数
     conn->setCloseCallback(
         std::bind(&TcpServer::removeConnection, this, std::placeholders::_1));
 
+    // 连接的建立和销毁是控制操作，排在大量普通回调之前执行
     ioLoop->runInLoop(
-        std::bind(&TcpConnection::connectEstablished, conn));
-}
+        std::bind(&TcpConnection::connectEstablished, conn), EventLoop::kControl);
 
-void TcpServer::removeConnection(const TcpConnectionPtr& conn)
-{ 
-  loop_->runInLoop(std::bind(&TcpServer::removeConnectionInLoop, this, conn));
+    if (idleTimeout_ > 0)
+    {
+        // start 之后 timingWheels_ 只读，可以在多个 loop 中同时查找
+        timingWheels_.find(ioLoop)->second->add(conn);
+    }
 }
 
-void TcpServer::removeConnectionInLoop(const TcpConnectionPtr& conn)
+TcpConnectionPtr TcpServer::findConnection(uint64_t id)
 {
-    LOG_INFO("TcpServer::removeConnectionInLoop [ %s ] - connection %s "
+    uint32_t index = ConnectionRegistry::shardOf(id);
+    if (index >= shards_.size())
+    {
+        return TcpConnectionPtr();
+    }
+    ConnectionShard *shard = shards_[index].get();
+    std::unique_lock<std::mutex> lock(shard->mutex);
+    return shard->registry.find(id);
+}
+
+void TcpServer::removeConnection(const TcpConnectionPtr& conn)
+{ 
+    LOG_INFO("TcpServer::removeConnection [ %s ] - connection %s "
                 , name_.data() , conn->name().data());
-    connections_.erase(conn->name());
     EventLoop *ioLoop = conn->getLoop();
+    ConnectionShard *shard = loopShards_.find(ioLoop)->second;
+    {
+        std::unique_lock<std::mutex> lock(shard->mutex);
+        // TcpServer 析构时已经取走了所有连接，由析构函数负责销毁
+        if (!shard->registry.remove(conn->id()))
+        {
+            return;
+        }
+    }
+    --numConnections_;
+    ioLoop->addConnectionCount(-1);
     ioLoop->queueInLoop(
-        std::bind(&TcpConnection::connectDestroyed, conn));
+        std::bind(&TcpConnection::connectDestroyed, conn), EventLoop::kControl);
 }
\ No newline at end of file
@@ -0,0 +1,16 @@
+#include "./net/Timer.h"
+
+std::atomic<int64_t> Timer::numCreated_(0);
+
+void Timer::restart(Timestamp now)
+{
+    if (repeat_)
+    {
+        // 以当前时间为基准计算下一次到期时间
+        expiration_ = addTime(now, interval_);
+    }
+    else
+    {
+        expiration_ = Timestamp::invalid();
+    }
+}
@@ -0,0 +1,82 @@
+#include "./net/TimingWheel.h"
+#include "./net/EventLoop.h"
+#include "./net/TcpConnection.h"
+#include "./log/Logging.h"
+
+#include <math.h>
+
+TimingWheel::TimingWheel(EventLoop *loop, int idleSeconds)
+    : loop_(loop),
+      idleSeconds_(idleSeconds),
+      buckets_(idleSeconds + 1),
+      cursor_(0)
+{
+}
+
+TimingWheel::~TimingWheel()
+{
+    loop_->cancel(timerId_);
+}
+
+void TimingWheel::start()
+{
+    std::weak_ptr<TimingWheel> wheel(shared_from_this());
+    timerId_ = loop_->runEvery(1.0, std::bind(&TimingWheel::onTimer, wheel));
+}
+
+void TimingWheel::add(const TcpConnectionPtr &conn)
+{
+    loop_->runInLoop(std::bind(&TimingWheel::addInLoop, shared_from_this(),
+                               WeakTcpConnectionPtr(conn)));
+}
+
+void TimingWheel::onTimer(const std::weak_ptr<TimingWheel> &wheel)
+{
+    std::shared_ptr<TimingWheel> guard(wheel.lock());
+    if (guard)
+    {
+        guard->tick();
+    }
+}
+
+void TimingWheel::addInLoop(const WeakTcpConnectionPtr &conn)
+{
+    // 放到 idleSeconds_ 秒之后才会转到的格子中
+    buckets_[(cursor_ + idleSeconds_) % buckets_.size()].push_back(conn);
+}
+
+void TimingWheel::tick()
+{
+    cursor_ = (cursor_ + 1) % buckets_.size();
+    // 把当前格子换出来，检查期间重新放入的连接不会落到同一个格子
+    Bucket bucket;
+    bucket.swap(buckets_[cursor_]);
+
+    Timestamp now(Timestamp::now());
+    for (const WeakTcpConnectionPtr &weakConn : bucket)
+    {
+        TcpConnectionPtr conn(weakConn.lock());
+        // 连接已经释放或者已经关闭，直接从时间轮中丢弃
+        if (!conn || conn->disconnected())
+        {
+            continue;
+        }
+
+        double remaining = timeDifference(addTime(conn->lastActiveTime(), idleSeconds_), now);
+        if (remaining <= 0.0)
+        {
+            LOG_INFO("TimingWheel close idle connection [ %s ]" , conn->name().c_str()) ;
+            conn->forceClose();
+        }
+        else
+        {
+            // 期间有数据到来，按剩余时间重新放入对应的格子
+            size_t ticks = static_cast<size_t>(::ceil(remaining));
+            if (ticks > static_cast<size_t>(idleSeconds_))
+            {
+                ticks = idleSeconds_;
+            }
+            buckets_[(cursor_ + ticks) % buckets_.size()].push_back(weakConn);
+        }
+    }
+}
@@ -0,0 +1,83 @@
+#include "./net/UdpServer.h"
+#include "./log/Logging.h"
+
+#include <future>
+
+// UdpSocket 的 Channel 只能在所属 loop 的线程中移除，其他线程需要等待该 loop 执行完成
+static void destroySocketInLoop(std::shared_ptr<UdpSocket> &socket)
+{
+    EventLoop *loop = socket->getLoop();
+    if (loop->isInLoopThread())
+    {
+        socket.reset();
+        return;
+    }
+    std::promise<void> done;
+    loop->runInLoop([&socket, &done]() {
+        socket.reset();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+UdpServer::UdpServer(EventLoop *loop, const InetAddress &listenAddr, const std::string &nameArg)
+    : loop_(loop)
+    , listenAddr_(listenAddr)
+    , name_(nameArg)
+    , threadPool_(new EventLoopThreadPool(loop, nameArg))
+    , batchSize_(UdpSocket::kDefaultBatchSize)
+    , maxDatagramSize_(UdpSocket::kDefaultMaxDatagramSize)
+    , gsoSegmentSize_(0)
+    , started_(0)
+{
+}
+
+UdpServer::~UdpServer()
+{
+    // 各个 loop 线程还在运行，先在各自的线程中关闭 socket
+    for (std::shared_ptr<UdpSocket> &socket : sockets_)
+    {
+        destroySocketInLoop(socket);
+    }
+}
+
+void UdpServer::start()
+{
+    if (started_++ == 0)
+    {
+        threadPool_->start(threadInitCallback_);
+        std::vector<EventLoop*> loops = threadPool_->getAllLoops();
+        // Unix 域地址没有 SO_REUSEPORT ，一个路径只能 bind 一次，只在第一个 loop 上创建 socket
+        if (listenAddr_.family() == AF_UNIX && loops.size() > 1)
+        {
+            LOG_WARN("UdpServer::start [ %s ] unix domain address %s is bound by one socket on the first loop only",
+                     name_.c_str(), listenAddr_.toIpPort().c_str());
+            loops.resize(1);
+        }
+        for (EventLoop *ioLoop : loops)
+        {
+            std::shared_ptr<UdpSocket> socket(new UdpSocket(ioLoop, listenAddr_, true));
+            socket->setBatchSize(batchSize_, maxDatagramSize_);
+            if (gsoSegmentSize_ > 0)
+            {
+                socket->setGsoSegmentSize(gsoSegmentSize_);
+            }
+            socket->setMessageCallback(messageCallback_);
+            socket->start();
+            sockets_.push_back(socket);
+        }
+        LOG_INFO("UdpServer::start [ %s ] listening on %s with %zu sockets", name_.c_str(), listenAddr_.toIpPort().c_str(), sockets_.size());
+    }
+}
+
+UdpServer::Stats UdpServer::stats() const
+{
+    Stats stats = {0, 0, 0};
+    for (const std::shared_ptr<UdpSocket> &socket : sockets_)
+    {
+        stats.received += socket->receivedCount();
+        stats.sent += socket->sentCount();
+        stats.dropped += socket->droppedCount();
+    }
+    return stats;
+}
@@ -0,0 +1,362 @@
+#include "./net/UdpSocket.h"
+#include "./net/EventLoop.h"
+#include "./log/Logging.h"
+
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <netinet/udp.h>
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+const int UdpSocket::kDefaultBatchSize;
+const size_t UdpSocket::kDefaultMaxDatagramSize;
+const int UdpSocket::kMaxBatchesPerRound;
+const size_t UdpSocket::kMaxPendingBytes;
+const int UdpSocket::kMaxGsoSegments;
+
+static const size_t kMaxUdpPayload = 65507;                           // IPv4 上一个 UDP 数据报最多的字节数
+static const size_t kControlSpace = CMSG_SPACE(sizeof(uint16_t));     // 一个 UDP_SEGMENT 控制消息占用的空间
+
+static int createNonblockingUdp(sa_family_t family)
+{
+    int sockfd = ::socket(family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, family == AF_UNIX ? 0 : IPPROTO_UDP);
+    if (sockfd < 0)
+    {
+        LOG_FATAL("udp socket create err %d", errno);
+    }
+    return sockfd;
+}
+
+UdpSocket::UdpSocket(EventLoop *loop, const InetAddress &bindAddr, bool reuseport)
+    : loop_(loop)
+    , socket_(createNonblockingUdp(bindAddr.family()))
+    , channel_(loop, socket_.fd())
+    , batchSize_(0)
+    , maxDatagramSize_(0)
+    , gsoSegmentSize_(0)
+    , pendingHead_(0)
+    , flushScheduled_(false)
+    , registered_(false)
+    , receivedCount_(0)
+    , sentCount_(0)
+    , droppedCount_(0)
+{
+    socket_.setReuseAddr(true);
+    socket_.setReusePort(reuseport);
+    socket_.bindAddress(bindAddr);
+    setBatchSize(kDefaultBatchSize, kDefaultMaxDatagramSize);
+
+    channel_.setReadCallback(std::bind(&UdpSocket::handleRead, this, std::placeholders::_1));
+    channel_.setWriteCallback(std::bind(&UdpSocket::handleWrite, this));
+}
+
+UdpSocket::~UdpSocket()
+{
+    unregister();
+}
+
+void UdpSocket::setBatchSize(int batchSize, size_t maxDatagramSize)
+{
+    batchSize_ = batchSize > 0 ? batchSize : 1;
+    maxDatagramSize_ = maxDatagramSize;
+
+    // 接收用的 iovec 和地址一次性设置好，每次 recvmmsg 只需要重置 msg_namelen
+    recvData_.assign(batchSize_ * maxDatagramSize_, 0);
+    recvMsgs_.assign(batchSize_, mmsghdr());
+    recvIovecs_.assign(batchSize_, iovec());
+    recvAddrs_.assign(batchSize_, sockaddr_storage());
+    datagrams_.assign(batchSize_, Datagram());
+    for (int i = 0; i < batchSize_; ++i)
+    {
+        recvIovecs_[i].iov_base = &recvData_[i * maxDatagramSize_];
+        recvIovecs_[i].iov_len = maxDatagramSize_;
+        msghdr &hdr = recvMsgs_[i].msg_hdr;
+        ::memset(&hdr, 0, sizeof(hdr));
+        hdr.msg_name = &recvAddrs_[i];
+        hdr.msg_iov = &recvIovecs_[i];
+        hdr.msg_iovlen = 1;
+    }
+
+    sendMsgs_.assign(batchSize_, mmsghdr());
+    sendIovecs_.assign(batchSize_, iovec());
+    sendRuns_.assign(batchSize_, 0);
+    sendControl_.assign(batchSize_ * kControlSpace, 0);
+}
+
+bool UdpSocket::setGsoSegmentSize(uint16_t segmentSize)
+{
+    if (segmentSize > 0)
+    {
+        // 只检查内核是否支持 UDP_SEGMENT ，分段大小通过每次发送的控制消息传入，不影响其他数据报
+        int value = 0;
+        socklen_t len = sizeof(value);
+        if (::getsockopt(socket_.fd(), SOL_UDP, UDP_SEGMENT, &value, &len) < 0)
+        {
+            LOG_WARN("UdpSocket::setGsoSegmentSize UDP_SEGMENT not supported, errno = %d", errno);
+            gsoSegmentSize_ = 0;
+            return false;
+        }
+    }
+    gsoSegmentSize_ = segmentSize;
+    return true;
+}
+
+void UdpSocket::start()
+{
+    std::shared_ptr<UdpSocket> self(shared_from_this());
+    loop_->runInLoop([self]() {
+        self->registered_ = true;
+        self->channel_.enableReading();
+    });
+}
+
+void UdpSocket::stop()
+{
+    unregister();
+}
+
+void UdpSocket::unregister()
+{
+    // stop 之后析构时不再重复移除，stop 之后又因为发送注册了可写事件时仍然需要移除
+    if (registered_)
+    {
+        channel_.disableAll();
+        channel_.remove();
+        registered_ = false;
+    }
+}
+
+void UdpSocket::handleRead(Timestamp receiveTime)
+{
+    for (int round = 0; round < kMaxBatchesPerRound; ++round)
+    {
+        for (int i = 0; i < batchSize_; ++i)
+        {
+            recvMsgs_[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+        }
+        int n = ::recvmmsg(socket_.fd(), recvMsgs_.data(), batchSize_, MSG_DONTWAIT, nullptr);
+        if (n < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                LOG_ERROR("UdpSocket::handleRead recvmmsg failed, errno = %d", errno);
+            }
+            return;
+        }
+
+        size_t count = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            if (recvMsgs_[i].msg_hdr.msg_flags & MSG_TRUNC)
+            {
+                // 比接收区更长的数据报只收到了前面一部分，交给上层也无法解析
+                droppedCount_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            Datagram &datagram = datagrams_[count++];
+            datagram.data = static_cast<const char *>(recvIovecs_[i].iov_base);
+            datagram.len = recvMsgs_[i].msg_len;
+            datagram.peer.setSockAddr(reinterpret_cast<const sockaddr *>(&recvAddrs_[i]), recvMsgs_[i].msg_hdr.msg_namelen);
+        }
+        receivedCount_.fetch_add(count, std::memory_order_relaxed);
+        if (count > 0 && messageCallback_)
+        {
+            messageCallback_(this, datagrams_.data(), count, receiveTime);
+        }
+        // 没有收满说明接收队列已经空了
+        if (n < batchSize_)
+        {
+            return;
+        }
+    }
+}
+
+void UdpSocket::sendTo(const char *data, size_t len, const InetAddress &peer)
+{
+    if (loop_->isInLoopThread())
+    {
+        sendInLoop(data, len, peer);
+    }
+    else
+    {
+        std::shared_ptr<UdpSocket> self(shared_from_this());
+        std::string message(data, len);
+        loop_->runInLoop([self, message, peer]() {
+            self->sendInLoop(message.data(), message.size(), peer);
+        });
+    }
+}
+
+void UdpSocket::sendInLoop(const char *data, size_t len, const InetAddress &peer)
+{
+    if (pendingData_.size() + len > kMaxPendingBytes)
+    {
+        // UDP 本身不保证送达，发送不出去时直接丢弃，不让队列无限增长
+        droppedCount_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Pending datagram;
+    datagram.offset = pendingData_.size();
+    datagram.len = len;
+    datagram.peer = peer;
+    pendingData_.append(data, len);
+    pending_.push_back(datagram);
+
+    // 等待可写时由 handleWrite 发送，否则本轮事件处理完之后一起发送
+    if (!flushScheduled_ && !channel_.isWriting())
+    {
+        flushScheduled_ = true;
+        loop_->queueInLoop(std::bind(&UdpSocket::flushAfterEvents, std::weak_ptr<UdpSocket>(shared_from_this())));
+    }
+}
+
+void UdpSocket::flushAfterEvents(const std::weak_ptr<UdpSocket> &weakSocket)
+{
+    std::shared_ptr<UdpSocket> socket(weakSocket.lock());
+    if (socket)
+    {
+        socket->flushScheduled_ = false;
+        socket->flush();
+    }
+}
+
+void UdpSocket::handleWrite()
+{
+    flush();
+}
+
+size_t UdpSocket::gsoRun(size_t first) const
+{
+    const Pending &head = pending_[first];
+    if (head.len != gsoSegmentSize_)
+    {
+        return 1;
+    }
+    size_t run = 1;
+    size_t bytes = head.len;
+    while (run < static_cast<size_t>(kMaxGsoSegments) && first + run < pending_.size())
+    {
+        const Pending &next = pending_[first + run];
+        if (next.len > gsoSegmentSize_ || bytes + next.len > kMaxUdpPayload ||
+            next.peer.getSockLen() != head.peer.getSockLen() ||
+            ::memcmp(next.peer.getSockAddr(), head.peer.getSockAddr(), head.peer.getSockLen()) != 0)
+        {
+            break;
+        }
+        ++run;
+        bytes += next.len;
+        // 只有最后一个分段可以比分段大小短
+        if (next.len < gsoSegmentSize_)
+        {
+            break;
+        }
+    }
+    return run;
+}
+
+void UdpSocket::flush()
+{
+    while (pendingHead_ < pending_.size())
+    {
+        int count = 0;
+        size_t next = pendingHead_;
+        while (count < batchSize_ && next < pending_.size())
+        {
+            size_t run = gsoSegmentSize_ > 0 ? gsoRun(next) : 1;
+            const Pending &first = pending_[next];
+            const Pending &last = pending_[next + run - 1];
+
+            // 连续入队的数据报在 pendingData_ 中是相邻的，合并的数据报只需要一个 iovec
+            iovec &vec = sendIovecs_[count];
+            vec.iov_base = &pendingData_[first.offset];
+            vec.iov_len = last.offset + last.len - first.offset;
+
+            msghdr &hdr = sendMsgs_[count].msg_hdr;
+            ::memset(&hdr, 0, sizeof(hdr));
+            hdr.msg_name = const_cast<sockaddr *>(first.peer.getSockAddr());
+            hdr.msg_namelen = first.peer.getSockLen();
+            hdr.msg_iov = &vec;
+            hdr.msg_iovlen = 1;
+            if (run > 1)
+            {
+                hdr.msg_control = &sendControl_[count * kControlSpace];
+                hdr.msg_controllen = kControlSpace;
+                cmsghdr *cm = CMSG_FIRSTHDR(&hdr);
+                cm->cmsg_level = SOL_UDP;
+                cm->cmsg_type = UDP_SEGMENT;
+                cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                ::memcpy(CMSG_DATA(cm), &gsoSegmentSize_, sizeof(uint16_t));
+            }
+            sendRuns_[count] = run;
+            ++count;
+            next += run;
+        }
+
+        int n = ::sendmmsg(socket_.fd(), sendMsgs_.data(), count, 0);
+        if (n < 0)
+        {
+            int savedErrno = errno;
+            if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK || savedErrno == ENOBUFS)
+            {
+                break;
+            }
+            if (sendRuns_[0] > 1 && (savedErrno == EIO || savedErrno == EINVAL))
+            {
+                // 出口网卡不支持分段或者分段大小超过了 MTU ，之后都逐个发送
+                LOG_WARN("UdpSocket::flush GSO send failed, errno = %d, disable GSO", savedErrno);
+                gsoSegmentSize_ = 0;
+                continue;
+            }
+            // 其他错误只丢弃队首的数据报，避免一个坏地址卡住整个队列
+            LOG_ERROR("UdpSocket::flush sendmmsg to %s failed, errno = %d", pending_[pendingHead_].peer.toIpPort().c_str(), savedErrno);
+            droppedCount_.fetch_add(sendRuns_[0], std::memory_order_relaxed);
+            pendingHead_ += sendRuns_[0];
+            continue;
+        }
+
+        size_t sent = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            sent += sendRuns_[i];
+        }
+        sentCount_.fetch_add(sent, std::memory_order_relaxed);
+        pendingHead_ += sent;
+    }
+
+    if (pendingHead_ == pending_.size())
+    {
+        pending_.clear();
+        pendingData_.clear();
+        pendingHead_ = 0;
+        if (channel_.isWriting())
+        {
+            channel_.disableWriting();
+        }
+        return;
+    }
+
+    // 发送缓冲区满了，移除已经发送的部分，等待可写事件再继续
+    if (pendingHead_ > 0)
+    {
+        size_t consumed = pending_[pendingHead_].offset;
+        pendingData_.erase(0, consumed);
+        pending_.erase(pending_.begin(), pending_.begin() + pendingHead_);
+        for (Pending &datagram : pending_)
+        {
+            datagram.offset -= consumed;
+        }
+        pendingHead_ = 0;
+    }
+    if (!channel_.isWriting())
+    {
+        registered_ = true;
+        channel_.enableWriting();
+    }
+}
@@ -0,0 +1,795 @@
+#include "./net/UringPoller.h"
+#include "./log/Logging.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <poll.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+
+// POLL_REMOVE/ASYNC_CANCEL 自身完成时返回的 user_data ，直接忽略
+static const uint64_t kRemoveUserData = ~0ULL;
+// 构造时检测内核特性的请求使用的 user_data ，之后返回的 CQE 同样忽略
+static const uint64_t kProbePollUserData = ~0ULL - 1;
+static const uint64_t kProbeAcceptUserData = ~0ULL - 2;
+static const uint64_t kProbeRecvUserData = ~0ULL - 3;
+static const uint64_t kProbeRemoveUserData = ~0ULL - 4;
+// PROVIDE_BUFFERS 完成时返回的 user_data ，只在出错时打印日志
+static const uint64_t kProvideUserData = ~0ULL - 5;
+// 上面这些 user_data 的高 32 位，正常请求中是 fd ，不会出现这个值
+static const uint64_t kInternalFd = 0xFFFFFFFFULL;
+
+// 请求类型，保存在 user_data 低 32 位的最高两位
+static const uint32_t kPollRequest = 0;
+static const uint32_t kAcceptRequest = 1;
+static const uint32_t kRecvRequest = 2;
+static const uint32_t kGenerationBits = 30;
+static const uint32_t kGenerationMask = (1U << kGenerationBits) - 1;
+
+// 所有 multishot recv 共用的 buffer group
+static const uint16_t kRecvBufferGroup = 0;
+// 检测 multishot recv 时临时注册的 buffer group
+static const uint16_t kProbeBufferGroup = 1;
+
+const unsigned UringPoller::kRecvBufferCount;
+const unsigned UringPoller::kRecvBufferSize;
+
+static int ioUringSetup(unsigned entries, io_uring_params *params)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int ioUringEnter(int ringfd, unsigned toSubmit, unsigned minComplete,
+                        unsigned flags, void *arg, size_t argsz)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_enter, ringfd, toSubmit, minComplete, flags, arg, argsz));
+}
+
+// user_data 高 32 位是 fd ，低 32 位是请求类型和注册的版本号
+static uint64_t makeUserData(int fd, uint32_t kind, uint32_t generation)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(fd)) << 32)
+           | (static_cast<uint64_t>(kind) << kGenerationBits) | generation;
+}
+
+// channel 的 accept/recv 请求类型
+static uint32_t completionKind(const Channel *channel)
+{
+    return channel->readMode() == Channel::kReadAccept ? kAcceptRequest : kRecvRequest;
+}
+
+static bool probeIoUring()
+{
+    io_uring_params params;
+    ::memset(&params, 0, sizeof(params));
+    int ringfd = ioUringSetup(4, &params);
+    if (ringfd < 0)
+    {
+        return false;
+    }
+    ::close(ringfd);
+    // EXT_ARG 用于 io_uring_enter 带超时等待，NODROP 保证完成队列满了也不会丢事件
+    return (params.features & IORING_FEAT_EXT_ARG) && (params.features & IORING_FEAT_NODROP);
+}
+
+bool UringPoller::isSupported()
+{
+    static const bool supported = probeIoUring();
+    return supported;
+}
+
+UringPoller::UringPoller(EventLoop *loop)
+    : Poller(loop),
+      ringfd_(-1),
+      sqRingPtr_(nullptr),
+      sqRingSize_(0),
+      sqHead_(nullptr),
+      sqTail_(nullptr),
+      sqRingMask_(0),
+      sqRingEntries_(0),
+      sqArray_(nullptr),
+      sqes_(nullptr),
+      sqesSize_(0),
+      cqRingPtr_(nullptr),
+      cqRingSize_(0),
+      cqHead_(nullptr),
+      cqTail_(nullptr),
+      cqRingMask_(0),
+      cqes_(nullptr),
+      multishotSupported_(false),
+      acceptSupported_(false),
+      recvSupported_(false),
+      recvBuffers_(nullptr),
+      reapRound_(0),
+      nextGeneration_(0)
+{
+    io_uring_params params;
+    ::memset(&params, 0, sizeof(params));
+    ringfd_ = ioUringSetup(kRingEntries, &params);
+    if (ringfd_ < 0)
+    {
+        LOG_FATAL("io_uring_setup() error: %d" , errno) ;
+    }
+
+    // 映射提交队列、完成队列和 SQE 数组，新内核中提交队列和完成队列可以一次映射
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMmap)
+    {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+
+    sqRingPtr_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ringfd_, IORING_OFF_SQ_RING);
+    if (sqRingPtr_ == MAP_FAILED)
+    {
+        LOG_FATAL("mmap io_uring sq ring error: %d" , errno) ;
+    }
+
+    if (singleMmap)
+    {
+        cqRingPtr_ = sqRingPtr_;
+    }
+    else
+    {
+        cqRingPtr_ = ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, ringfd_, IORING_OFF_CQ_RING);
+        if (cqRingPtr_ == MAP_FAILED)
+        {
+            LOG_FATAL("mmap io_uring cq ring error: %d" , errno) ;
+        }
+    }
+
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE,
+                                              MAP_SHARED | MAP_POPULATE, ringfd_, IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED)
+    {
+        LOG_FATAL("mmap io_uring sqes error: %d" , errno) ;
+    }
+
+    char *sq = static_cast<char*>(sqRingPtr_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqRingMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqRingEntries_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+    sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+    char *cq = static_cast<char*>(cqRingPtr_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqRingMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    multishotSupported_ = probeMultishot();
+    if (!multishotSupported_)
+    {
+        LOG_INFO("io_uring multishot poll is not supported, edge-triggered channels use one-shot poll");
+    }
+    acceptSupported_ = probeMultishotAccept();
+    recvSupported_ = probeMultishotRecv();
+    if (!acceptSupported_ || !recvSupported_)
+    {
+        LOG_INFO("io_uring multishot accept %s, multishot recv %s, unsupported ones use readiness poll",
+                 acceptSupported_ ? "supported" : "not supported", recvSupported_ ? "supported" : "not supported");
+    }
+}
+
+bool UringPoller::waitProbe(const std::function<bool(const io_uring_cqe&)> &fn)
+{
+    bool done = false;
+    // 最多等待 1 秒，内核不支持的请求会立即返回错误
+    for (int i = 0; i < 10 && !done; ++i)
+    {
+        enter(1, 100);
+        unsigned head = *cqHead_;
+        const unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head)
+        {
+            if (!done && fn(cqes_[head & cqRingMask_]))
+            {
+                done = true;
+            }
+        }
+        __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+    }
+    return done;
+}
+
+bool UringPoller::probeMultishot()
+{
+    // 计数为 1 的 eventfd 一直可读，支持 multishot 时返回的 CQE 带有 IORING_CQE_F_MORE
+    int efd = ::eventfd(1, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (efd < 0)
+    {
+        return false;
+    }
+
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = efd;
+    sqe->poll32_events = POLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = kProbePollUserData;
+
+    bool supported = false;
+    waitProbe([&supported](const io_uring_cqe &cqe) {
+        if (cqe.user_data != kProbePollUserData)
+        {
+            return false;
+        }
+        supported = cqe.res > 0 && (cqe.flags & IORING_CQE_F_MORE);
+        return true;
+    });
+
+    if (supported)
+    {
+        // 请求仍然挂在 eventfd 上，关闭 fd 不会取消它，需要显式删除，之后返回的 CQE 在 reapCompletions 中忽略
+        sqe = getSqe();
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->fd = -1;
+        sqe->addr = kProbePollUserData;
+        sqe->user_data = kRemoveUserData;
+        enter(0, 0);
+    }
+    ::close(efd);
+    return supported;
+}
+
+bool UringPoller::probeMultishotAccept()
+{
+    // 自动绑定到抽象命名空间的 Unix 域 socket ，不占用端口和文件路径
+    int listenfd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenfd < 0)
+    {
+        return false;
+    }
+    sockaddr_un addr;
+    ::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    socklen_t len = sizeof(addr);
+    if (::bind(listenfd, reinterpret_cast<sockaddr*>(&addr), sizeof(sa_family_t)) < 0
+        || ::listen(listenfd, 4) < 0
+        || ::getsockname(listenfd, reinterpret_cast<sockaddr*>(&addr), &len) < 0)
+    {
+        ::close(listenfd);
+        return false;
+    }
+
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listenfd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = kProbeAcceptUserData;
+    enter(0, 0);
+
+    int clientfd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (clientfd >= 0)
+    {
+        ::connect(clientfd, reinterpret_cast<sockaddr*>(&addr), len);
+    }
+
+    bool supported = false;
+    waitProbe([&supported](const io_uring_cqe &cqe) {
+        if (cqe.user_data != kProbeAcceptUserData)
+        {
+            return false;
+        }
+        if (cqe.res >= 0)
+        {
+            ::close(cqe.res);
+        }
+        supported = cqe.res >= 0 && (cqe.flags & IORING_CQE_F_MORE);
+        return true;
+    });
+
+    if (supported)
+    {
+        sqe = getSqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = kProbeAcceptUserData;
+        sqe->user_data = kRemoveUserData;
+        enter(0, 0);
+    }
+    if (clientfd >= 0)
+    {
+        ::close(clientfd);
+    }
+    ::close(listenfd);
+    return supported;
+}
+
+bool UringPoller::probeMultishotRecv()
+{
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) < 0)
+    {
+        return false;
+    }
+    char buf[64];
+    ssize_t n = ::write(fds[1], "x", 1);
+    (void)n;
+
+    // 给临时的 buffer group 提供一个缓冲区，紧接着提交 multishot recv ，同一次 io_uring_enter 中按顺序执行
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = 1;
+    sqe->addr = reinterpret_cast<uint64_t>(buf);
+    sqe->len = sizeof(buf);
+    sqe->buf_group = kProbeBufferGroup;
+    sqe->user_data = kRemoveUserData;
+
+    sqe = getSqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fds[0];
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = kProbeBufferGroup;
+    sqe->user_data = kProbeRecvUserData;
+
+    bool supported = false;
+    bool more = false;
+    waitProbe([&supported, &more](const io_uring_cqe &cqe) {
+        if (cqe.user_data != kProbeRecvUserData)
+        {
+            return false;
+        }
+        more = cqe.flags & IORING_CQE_F_MORE;
+        supported = cqe.res == 1 && (cqe.flags & IORING_CQE_F_BUFFER) && more;
+        return true;
+    });
+
+    if (more)
+    {
+        // 等请求被取消之后 buf 才不会再被内核使用
+        sqe = getSqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = kProbeRecvUserData;
+        sqe->user_data = kRemoveUserData;
+        waitProbe([](const io_uring_cqe &cqe) {
+            return cqe.user_data == kProbeRecvUserData && !(cqe.flags & IORING_CQE_F_MORE);
+        });
+    }
+    // 不支持时缓冲区可能还留在 buffer group 中，删除之后 buf 才能释放
+    sqe = getSqe();
+    sqe->opcode = IORING_OP_REMOVE_BUFFERS;
+    sqe->fd = 1;
+    sqe->buf_group = kProbeBufferGroup;
+    sqe->user_data = kProbeRemoveUserData;
+    waitProbe([](const io_uring_cqe &cqe) { return cqe.user_data == kProbeRemoveUserData; });
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return supported;
+}
+
+void UringPoller::provideRecvBuffers()
+{
+    recvBuffers_ = new char[static_cast<size_t>(kRecvBufferCount) * kRecvBufferSize];
+
+    // 一个 SQE 提供全部缓冲区，编号从 0 开始
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = static_cast<int>(kRecvBufferCount);
+    sqe->addr = reinterpret_cast<uint64_t>(recvBuffers_);
+    sqe->len = kRecvBufferSize;
+    sqe->off = 0;
+    sqe->buf_group = kRecvBufferGroup;
+    sqe->user_data = kProvideUserData;
+}
+
+void UringPoller::recycleBuffer(uint16_t bid)
+{
+    // 和下一次 poll 的其他 SQE 一起提交，排在重新提交的 recv 请求之前
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = 1;
+    sqe->addr = reinterpret_cast<uint64_t>(recvBuffers_ + static_cast<size_t>(bid) * kRecvBufferSize);
+    sqe->len = kRecvBufferSize;
+    sqe->off = bid;
+    sqe->buf_group = kRecvBufferGroup;
+    sqe->user_data = kProvideUserData;
+}
+
+UringPoller::~UringPoller()
+{
+    // 提交还没有提交的取消请求，请求持有的 socket 在这里同步释放，否则要等内核异步清理 ring ，监听地址不能立即重新 bind
+    enter(0, 0);
+    ::munmap(sqes_, sqesSize_);
+    if (cqRingPtr_ != sqRingPtr_)
+    {
+        ::munmap(cqRingPtr_, cqRingSize_);
+    }
+    ::munmap(sqRingPtr_, sqRingSize_);
+    ::close(ringfd_);
+    // 关闭 ring 之后内核不会再写入这些缓冲区
+    delete[] recvBuffers_;
+}
+
+Timestamp UringPoller::poll(int timeoutMs, ChannelList *activeChannels)
+{
+    // 上一轮返回的单次 poll 在 Channel 处理完事件之后重新提交，仍然就绪的 fd 会立即再次返回，等价于水平触发
+    // 结束的 accept/recv 请求(缓冲区用完、被取消或者出错)同样在这里重新提交
+    for (int fd : rearmFds_)
+    {
+        RegistrationMap::iterator it = registrations_.find(fd);
+        if (it == registrations_.end())
+        {
+            continue;
+        }
+        Registration &reg = it->second;
+        if (reg.armedEvents == 0 && pollEvents(reg.channel) != 0)
+        {
+            arm(fd, reg);
+        }
+        updateCompletion(fd, reg);
+    }
+    rearmFds_.clear();
+
+    // 提交所有 SQE 的同时等待事件，只有一次系统调用
+    int ret = enter(timeoutMs == 0 ? 0 : 1, timeoutMs);
+    int saveErrno = errno;
+    Timestamp now(Timestamp::now());
+
+    if (ret < 0 && saveErrno != ETIME && saveErrno != EINTR)
+    {
+        errno = saveErrno;
+        LOG_ERROR("UringPoller::poll() failed: %d" , saveErrno);
+    }
+
+    reapCompletions(activeChannels);
+    if (activeChannels->empty() && timeoutMs != 0)
+    {
+        LOG_DEBUG("timeout!");
+    }
+    return now;
+}
+
+void UringPoller::updateChannel(Channel *channel)
+{
+    const int fd = channel->fd();
+
+    if (channels_.find(fd) != channel)
+    {
+        channels_.insert(fd, channel, kNew);
+        Registration reg;
+        reg.channel = channel;
+        reg.generation = 0;
+        reg.armedEvents = 0;
+        reg.multishot = false;
+        reg.completionGeneration = 0;
+        reg.completionState = kCompletionIdle;
+        reg.activeRound = 0;
+        registrations_[fd] = reg;
+        // 由 Poller 直接完成读操作要在第一次注册时决定，之后不再改变
+        channel->setCompletionReads((channel->readMode() == Channel::kReadAccept && acceptSupported_)
+                                    || (channel->readMode() == Channel::kReadRecv && recvSupported_));
+    }
+
+    Registration &reg = registrations_[fd];
+    reg.channel = channel;
+
+    const uint32_t events = pollEvents(channel);
+    if (events == 0)
+    {
+        // 不需要等待的事件，取消正在等待的 poll 请求
+        if (reg.armedEvents != 0)
+        {
+            disarm(fd, reg);
+        }
+    }
+    else if (reg.armedEvents != events || reg.multishot != wantMultishot(channel))
+    {
+        // 关注的事件发生变化，取消之前的请求重新提交
+        if (reg.armedEvents != 0)
+        {
+            disarm(fd, reg);
+        }
+        arm(fd, reg);
+    }
+    updateCompletion(fd, reg);
+    channels_.slot(fd).state = channel->isNoneEvent() ? kDeleted : kAdded;
+}
+
+void UringPoller::removeChannel(Channel *channel)
+{
+    const int fd = channel->fd();
+    if (channels_.find(fd) != channel)
+    {
+        return;
+    }
+    channels_.erase(fd);
+
+    RegistrationMap::iterator it = registrations_.find(fd);
+    if (it != registrations_.end())
+    {
+        if (it->second.armedEvents != 0)
+        {
+            disarm(fd, it->second);
+        }
+        if (it->second.completionState == kCompletionArmed)
+        {
+            cancelCompletion(fd, it->second);
+        }
+        registrations_.erase(it);
+    }
+}
+
+uint32_t UringPoller::pollEvents(const Channel *channel)
+{
+    uint32_t events = static_cast<uint32_t>(channel->events());
+    if (channel->completionReads())
+    {
+        events &= ~static_cast<uint32_t>(EPOLLIN | EPOLLPRI);
+    }
+    return events;
+}
+
+uint32_t UringPoller::newGeneration()
+{
+    nextGeneration_ = (nextGeneration_ + 1) & kGenerationMask;
+    // 0 是新注册还没有提交过请求时的版本号
+    if (nextGeneration_ == 0)
+    {
+        nextGeneration_ = 1;
+    }
+    return nextGeneration_;
+}
+
+void UringPoller::arm(int fd, Registration &reg)
+{
+    io_uring_sqe *sqe = getSqe();
+    reg.generation = newGeneration();
+    reg.armedEvents = pollEvents(reg.channel);
+    reg.multishot = wantMultishot(reg.channel);
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = reg.armedEvents;
+    // multishot poll 只在 fd 状态变化时返回，等价于 EPOLLET ；不支持时边缘触发的 Channel 也使用单次 poll ，
+    // Channel 每次都读写到 EAGAIN ，按水平触发多返回的事件只是多一次空读
+    sqe->len = reg.multishot ? IORING_POLL_ADD_MULTI : 0;
+    sqe->user_data = makeUserData(fd, kPollRequest, reg.generation);
+}
+
+void UringPoller::disarm(int fd, Registration &reg)
+{
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = makeUserData(fd, kPollRequest, reg.generation);
+    sqe->user_data = kRemoveUserData;
+
+    // 换一个新的版本号，被取消的请求返回的 CQE 会被丢弃
+    reg.generation = newGeneration();
+    reg.armedEvents = 0;
+}
+
+void UringPoller::updateCompletion(int fd, Registration &reg)
+{
+    if (!reg.channel->completionReads())
+    {
+        return;
+    }
+    // 正在取消时等最后一个 CQE 返回之后在 poll 中重新判断
+    if (reg.channel->isReading() && reg.completionState == kCompletionIdle)
+    {
+        armCompletion(fd, reg);
+    }
+    else if (!reg.channel->isReading() && reg.completionState == kCompletionArmed)
+    {
+        cancelCompletion(fd, reg);
+    }
+}
+
+void UringPoller::armCompletion(int fd, Registration &reg)
+{
+    const uint32_t kind = completionKind(reg.channel);
+    if (kind == kRecvRequest && recvBuffers_ == nullptr)
+    {
+        provideRecvBuffers();
+    }
+
+    io_uring_sqe *sqe = getSqe();
+    reg.completionGeneration = newGeneration();
+    reg.completionState = kCompletionArmed;
+    sqe->fd = fd;
+    if (kind == kAcceptRequest)
+    {
+        // 不传地址，新连接的地址由 Acceptor 通过 getpeername 获取，多个 CQE 不能共用同一块地址
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    }
+    else
+    {
+        // 每次有数据时内核从 buffer group 中取一个缓冲区，CQE 的 flags 中返回缓冲区编号
+        sqe->opcode = IORING_OP_RECV;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = kRecvBufferGroup;
+    }
+    sqe->user_data = makeUserData(fd, kind, reg.completionGeneration);
+}
+
+void UringPoller::cancelCompletion(int fd, Registration &reg)
+{
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = makeUserData(fd, completionKind(reg.channel), reg.completionGeneration);
+    sqe->user_data = kRemoveUserData;
+    reg.completionState = kCompletionCanceling;
+}
+
+void UringPoller::markActive(Registration &reg, int revents, ChannelList *activeChannels)
+{
+    if (reg.activeRound == reapRound_)
+    {
+        reg.channel->set_revents(reg.channel->revents() | revents);
+        return;
+    }
+    reg.activeRound = reapRound_;
+    reg.channel->set_revents(revents);
+    activeChannels->push_back(reg.channel);
+}
+
+io_uring_sqe* UringPoller::getSqe()
+{
+    unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    unsigned tail = *sqTail_;
+    if (tail - head >= sqRingEntries_)
+    {
+        // 提交队列满了，先提交给内核腾出位置
+        enter(0, 0);
+        head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        if (tail - head >= sqRingEntries_)
+        {
+            LOG_FATAL("io_uring submission queue is full") ;
+        }
+    }
+
+    unsigned index = tail & sqRingMask_;
+    io_uring_sqe *sqe = &sqes_[index];
+    ::memset(sqe, 0, sizeof(*sqe));
+    sqArray_[index] = index;
+    // 没有使用 SQPOLL ，内核只会在 io_uring_enter 时读取 SQE ，可以先移动 tail 再填写内容
+    __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+    return sqe;
+}
+
+int UringPoller::enter(unsigned waitNr, int timeoutMs)
+{
+    unsigned toSubmit = *sqTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    unsigned flags = 0;
+    io_uring_getevents_arg arg;
+    __kernel_timespec ts;
+    ::memset(&arg, 0, sizeof(arg));
+    void *argp = nullptr;
+    size_t argsz = 0;
+
+    if (waitNr > 0)
+    {
+        flags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+        if (timeoutMs >= 0)
+        {
+            ts.tv_sec = timeoutMs / 1000;
+            ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000 * 1000;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+        }
+        argp = &arg;
+        argsz = sizeof(arg);
+    }
+    else if (toSubmit == 0)
+    {
+        return 0;
+    }
+
+    return ioUringEnter(ringfd_, toSubmit, waitNr, flags, argp, argsz);
+}
+
+void UringPoller::reapCompletions(ChannelList *activeChannels)
+{
+    ++reapRound_;
+    unsigned head = *cqHead_;
+    const unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; ++head)
+    {
+        const io_uring_cqe *cqe = &cqes_[head & cqRingMask_];
+        // POLL_REMOVE/ASYNC_CANCEL 自身和构造时检测特性的请求
+        if ((cqe->user_data >> 32) == kInternalFd)
+        {
+            if (cqe->user_data == kProvideUserData && cqe->res < 0)
+            {
+                LOG_ERROR("io_uring provide buffers error: %d" , -cqe->res) ;
+            }
+            continue;
+        }
+
+        const int fd = static_cast<int>(cqe->user_data >> 32);
+        const uint32_t kind = static_cast<uint32_t>(cqe->user_data) >> kGenerationBits;
+        const uint32_t generation = static_cast<uint32_t>(cqe->user_data) & kGenerationMask;
+        RegistrationMap::iterator it = registrations_.find(fd);
+
+        if (kind == kPollRequest)
+        {
+            // Channel 已经被移除或者重新提交过，过期的 CQE 直接丢弃
+            if (it == registrations_.end() || it->second.generation != generation)
+            {
+                continue;
+            }
+
+            Registration &reg = it->second;
+            // 没有 IORING_CQE_F_MORE 说明这个 poll 请求已经结束，需要重新提交
+            if (!(cqe->flags & IORING_CQE_F_MORE))
+            {
+                reg.armedEvents = 0;
+                rearmFds_.push_back(fd);
+            }
+
+            if (cqe->res < 0)
+            {
+                if (cqe->res != -ECANCELED)
+                {
+                    LOG_ERROR("io_uring poll fd = %d error: %d" , fd , -cqe->res) ;
+                }
+                continue;
+            }
+            markActive(reg, cqe->res, activeChannels);
+            continue;
+        }
+
+        // accept/recv 的结果，recv 的数据在内核选出的缓冲区中，交给 Channel 之后重新提供给内核
+        const char *data = nullptr;
+        uint16_t bid = 0;
+        if (cqe->flags & IORING_CQE_F_BUFFER)
+        {
+            bid = static_cast<uint16_t>(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+            data = recvBuffers_ + static_cast<size_t>(bid) * kRecvBufferSize;
+        }
+
+        if (it == registrations_.end()
+            || it->second.completionState == kCompletionIdle
+            || it->second.completionGeneration != generation)
+        {
+            // Channel 已经被移除，接收到的连接直接关闭，不能泄漏 fd
+            if (kind == kAcceptRequest && cqe->res >= 0)
+            {
+                ::close(cqe->res);
+            }
+        }
+        else
+        {
+            Registration &reg = it->second;
+            if (!(cqe->flags & IORING_CQE_F_MORE))
+            {
+                reg.completionState = kCompletionIdle;
+                rearmFds_.push_back(fd);
+            }
+            // 取消或者缓冲区用完(ENOBUFS)时请求结束，数据还在 socket 中，重新提交之后继续接收
+            if (cqe->res != -ECANCELED && cqe->res != -ENOBUFS)
+            {
+                reg.channel->handleCompletion(cqe->res, data);
+                markActive(reg, EPOLLIN, activeChannels);
+            }
+        }
+
+        if (data)
+        {
+            recycleBuffer(bid);
+        }
+    }
+
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+}
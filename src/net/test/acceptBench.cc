@@ -0,0 +1,115 @@
+#include "./net/TcpServer.h"
+#include "./log/Logging.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * 短连接压测：客户端不断 connect -> 发送一个字节 -> 服务器回显后主动关闭 -> 客户端读到 EOF 后 close ，统计每秒完成的连接数
+ * 分别测试 mainLoop 单 Acceptor 、每个 loop 一个 SO_REUSEPORT 监听 socket 、EPOLLEXCLUSIVE 共享监听 socket 三种模式
+ *
+ * 用法: acceptBench [subLoop 数] [客户端线程数] [测试秒数]
+ */
+
+static double runBench(TcpServer::AcceptMode mode, uint16_t port,
+                       int numLoops, int numClients, int seconds)
+{
+    EventLoop *serverLoop = nullptr;
+    std::mutex mutex;
+    std::condition_variable cond;
+
+    std::thread server([&]() {
+        EventLoop loop;
+        InetAddress addr(port);
+        TcpServer echo(&loop, addr, "AcceptBench");
+        echo.setThreadNum(numLoops);
+        echo.setAcceptMode(mode);
+        echo.setConnectionCallback([](const TcpConnectionPtr &) {});
+        echo.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+            conn->send(buf);
+            // 服务器主动关闭，TIME_WAIT 留在服务器一侧，客户端不会耗尽本地端口
+            conn->shutdown();
+        });
+        echo.start();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            serverLoop = &loop;
+            cond.notify_one();
+        }
+        loop.loop();
+    });
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&]() { return serverLoop != nullptr; });
+    }
+    // 等待各个 subLoop 完成 listen
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::atomic<int64_t> connections(0);
+    std::atomic_bool stop(false);
+    std::vector<std::thread> clients;
+    for (int i = 0; i < numClients; ++i)
+    {
+        clients.emplace_back([&]() {
+            sockaddr_in addr;
+            ::memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_port = ::htons(port);
+            addr.sin_addr.s_addr = ::inet_addr("127.0.0.1");
+            int64_t count = 0;
+            while (!stop)
+            {
+                int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+                char c = 'x';
+                if (::connect(fd, (sockaddr *)&addr, sizeof(addr)) == 0
+                    && ::write(fd, &c, 1) == 1
+                    && ::read(fd, &c, 1) == 1
+                    && ::read(fd, &c, 1) == 0)
+                {
+                    ++count;
+                }
+                ::close(fd);
+            }
+            connections += count;
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    for (std::thread &t : clients)
+    {
+        t.join();
+    }
+    serverLoop->quit();
+    server.join();
+    return static_cast<double>(connections) / seconds;
+}
+
+int main(int argc, char *argv[])
+{
+    Logger::setLogLevel(Logger::ERROR);
+
+    int numLoops = argc > 1 ? ::atoi(argv[1]) : 4;
+    int numClients = argc > 2 ? ::atoi(argv[2]) : 8;
+    int seconds = argc > 3 ? ::atoi(argv[3]) : 5;
+
+    printf("%d subloops, %d client threads, %d seconds\n", numLoops, numClients, seconds);
+    printf("single acceptor   : %10.0f conn/s\n",
+           runBench(TcpServer::kSingleAcceptor, 18092, numLoops, numClients, seconds));
+    printf("reuseport per loop: %10.0f conn/s\n",
+           runBench(TcpServer::kReusePortPerLoop, 18093, numLoops, numClients, seconds));
+    printf("epollexclusive    : %10.0f conn/s\n",
+           runBench(TcpServer::kExclusiveShared, 18094, numLoops, numClients, seconds));
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include "./net/TcpServer.h"
+#include "./log/Logging.h"
+
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <future>
+#include <vector>
+
+/**
+ * 客户端每隔一段时间向回显服务器发送一个小请求，模拟请求之间 loop 处于空闲的场景
+ * 客户端用非阻塞 recv 自旋等待回复，测得的往返延迟中只有服务器端是否需要被唤醒的差别
+ * 分别关闭和开启 EventLoop 忙轮询，输出往返延迟的分位数，以及请求结束之后空闲时服务器线程的 CPU 占用
+ *
+ * 用法: busyPollBench [请求次数] [请求间隔(微秒)] [忙轮询时间(微秒)]
+ */
+
+static double threadCpuSeconds()
+{
+    rusage usage;
+    ::getrusage(RUSAGE_THREAD, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+        + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static void runBench(const char *name, int spinMicros, int rounds, int gapMicros)
+{
+    InetAddress addr(18600, "127.0.0.1");
+    std::promise<EventLoop *> started;
+    std::promise<double> idleCpu;
+    std::thread server([&]() {
+        EventLoop loop;
+        TcpServer echo(&loop, addr, "BusyPollBench");
+        SocketOptions options;
+        options.tcpNoDelay = true;
+        echo.setSocketOptions(options);
+        echo.setBusyPoll(spinMicros);
+        echo.setConnectionCallback([](const TcpConnectionPtr &) {});
+        echo.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+            conn->send(buf);
+        });
+        echo.start();
+        started.set_value(&loop);
+        loop.loop();
+        idleCpu.set_value(threadCpuSeconds());
+    });
+    EventLoop *serverLoop = started.get_future().get();
+
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (::connect(fd, addr.getSockAddr(), addr.getSockLen()) < 0)
+    {
+        ::perror("connect");
+        ::exit(1);
+    }
+    char request[64] = {0};
+    char reply[64];
+    std::vector<double> rtts;
+    rtts.reserve(rounds);
+    for (int i = 0; i < rounds; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(gapMicros));
+        auto start = std::chrono::steady_clock::now();
+        ::send(fd, request, sizeof request, 0);
+        size_t received = 0;
+        while (received < sizeof request)
+        {
+            ssize_t n = ::recv(fd, reply + received, sizeof reply - received, MSG_DONTWAIT);
+            if (n > 0)
+            {
+                received += n;
+            }
+            else if (n == 0 || errno != EAGAIN)
+            {
+                ::perror("recv");
+                ::exit(1);
+            }
+        }
+        rtts.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    // 请求结束之后空闲一秒，服务器线程应该退回阻塞，几乎不占用 CPU
+    std::promise<double> busyCpu;
+    serverLoop->runInLoop([&]() { busyCpu.set_value(threadCpuSeconds()); });
+    double cpuBeforeIdle = busyCpu.get_future().get();
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    ::close(fd);
+    serverLoop->quit();
+    double cpuAfterIdle = idleCpu.get_future().get();
+    server.join();
+
+    std::sort(rtts.begin(), rtts.end());
+    printf("%-10s %10.2f %10.2f %10.2f %14.1f%%\n", name,
+           rtts[rtts.size() / 2], rtts[rtts.size() * 99 / 100], rtts.back(),
+           (cpuAfterIdle - cpuBeforeIdle) * 100);
+}
+
+int main(int argc, char *argv[])
+{
+    Logger::setLogLevel(Logger::ERROR);
+
+    int rounds = argc > 1 ? ::atoi(argv[1]) : 20000;
+    int gapMicros = argc > 2 ? ::atoi(argv[2]) : 20;
+    int spinMicros = argc > 3 ? ::atoi(argv[3]) : 50;
+
+    printf("%d requests, %d us apart, busy poll %d us\n", rounds, gapMicros, spinMicros);
+    printf("%-10s %10s %10s %10s %15s\n", "mode", "p50 us", "p99 us", "max us", "idle cpu");
+    runBench("blocking", 0, rounds, gapMicros);
+    runBench("busy-poll", spinMicros, rounds, gapMicros);
+    return 0;
+}
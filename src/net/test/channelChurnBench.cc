@@ -0,0 +1,92 @@
+#include "./net/EventLoop.h"
+#include "./net/Channel.h"
+#include "./log/Logging.h"
+
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
+/**
+ * 一个 loop 上注册大量 eventfd ，模拟连接很多的 loop 上 Channel 的注册、移除和事件分发
+ * churn: 随机选一个 channel 先 remove 再重新注册，相当于一个连接关闭、一个新连接建立
+ * dispatch: 所有 eventfd 同时可读，一次 poll 返回全部活跃 channel
+ *
+ * 用法: channelChurnBench [channel 个数] [churn 次数]，channel 个数受 RLIMIT_NOFILE 限制
+ */
+
+int main(int argc, char *argv[])
+{
+    Logger::setLogLevel(Logger::ERROR);
+
+    int numChannels = argc > 1 ? ::atoi(argv[1]) : 10000;
+    int churns = argc > 2 ? ::atoi(argv[2]) : 1000000;
+
+    rlimit limit;
+    ::getrlimit(RLIMIT_NOFILE, &limit);
+    if (limit.rlim_cur < static_cast<rlim_t>(numChannels) + 64)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+        if (limit.rlim_cur < static_cast<rlim_t>(numChannels) + 64)
+        {
+            numChannels = static_cast<int>(limit.rlim_cur) - 64;
+        }
+    }
+
+    EventLoop loop;
+    std::vector<std::unique_ptr<Channel>> channels;
+    for (int i = 0; i < numChannels; ++i)
+    {
+        int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        channels.emplace_back(new Channel(&loop, fd));
+        channels.back()->setReadCallback([fd](Timestamp) {
+            uint64_t value;
+            ::read(fd, &value, sizeof value);
+        });
+        channels.back()->enableReading();
+    }
+
+    std::minstd_rand random(1);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < churns; ++i)
+    {
+        Channel *channel = channels[random() % numChannels].get();
+        channel->disableAll();
+        channel->remove();
+        channel->enableReading();
+    }
+    double churnNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / churns;
+
+    // 每轮把所有 eventfd 设为可读，测量 loop 一轮分发全部事件的时间
+    const int rounds = 20;
+    uint64_t one = 1;
+    double dispatchNs = 0;
+    for (int r = 0; r < rounds; ++r)
+    {
+        for (auto &channel : channels)
+        {
+            ::write(channel->fd(), &one, sizeof one);
+        }
+        auto roundStart = std::chrono::steady_clock::now();
+        loop.runAfter(0, [&loop]() { loop.quit(); });
+        loop.loop();
+        dispatchNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - roundStart).count();
+    }
+
+    printf("%d channels: churn %.0f ns/op, dispatch %.1f ns/event\n",
+           numChannels, churnNs, dispatchNs / rounds / numChannels);
+
+    for (auto &channel : channels)
+    {
+        channel->disableAll();
+        channel->remove();
+        ::close(channel->fd());
+    }
+    return 0;
+}
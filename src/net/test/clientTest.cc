@@ -0,0 +1,70 @@
+#include "./net/TcpClient.h"
+#include "./net/EventLoop.h"
+#include "./log/Logging.h"
+
+#include <stdlib.h>
+
+/**
+ * 连接 serverTest 启动的回显服务器，每秒发送一条消息
+ * 服务器还没有启动或者中途重启时按指数退避自动重连
+ *
+ * 用法: clientTest [ip] [port]
+ */
+class EchoClient
+{
+public :
+    EchoClient(EventLoop *loop , const InetAddress &addr)
+        : client_(loop , addr , "EchoClient") , loop_(loop)
+    {
+        client_.setConnectionCallback(std::bind(&EchoClient::connection , this , std::placeholders::_1)) ;
+        client_.setMessageCallback(std::bind(&EchoClient::message , this , std::placeholders::_1 , std::placeholders::_2 , std::placeholders::_3)) ;
+        client_.setConnectTimeout(3) ;
+        client_.enableRetry() ;
+    }
+
+    void connect()
+    {
+        client_.connect() ;
+        loop_->runEvery(1.0 , std::bind(&EchoClient::tick , this)) ;
+    }
+
+private :
+    void connection(const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            LOG_INFO("connected: %s", conn->name().data());
+        }
+        else
+        {
+            LOG_INFO("disconnected: %s", conn->name().data());
+        }
+    }
+
+    void message(const TcpConnectionPtr & , Buffer *buffer , Timestamp)
+    {
+        LOG_INFO("echo: %s", buffer->retrieveAllAsString().data());
+    }
+
+    void tick()
+    {
+        TcpConnectionPtr conn = client_.connection() ;
+        if (conn)
+        {
+            conn->send("hello\n") ;
+        }
+    }
+
+    TcpClient client_ ;
+    EventLoop *loop_ ;
+} ;
+
+int main(int argc , char *argv[])
+{
+    EventLoop loop ;
+    InetAddress addr(argc > 2 ? atoi(argv[2]) : 8080 , argc > 1 ? argv[1] : "127.0.0.1") ;
+    EchoClient client(&loop , addr) ;
+    client.connect() ;
+    loop.loop() ;
+    return 0 ;
+}
@@ -0,0 +1,107 @@
+#include "./net/TcpServer.h"
+#include "./net/EventLoopThread.h"
+#include "./log/Logging.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <vector>
+
+/**
+ * 其他线程向 loop 投递大量耗时的普通回调，同时客户端对 loop 上的回显连接做 ping-pong
+ * 对比不限制和限制每轮回调数时往返延迟的分位数，以及执行完所有回调的总时间
+ *
+ * 用法: functorFloodBench [回调个数] [每个回调的耗时(微秒)] [每轮最多执行的回调数]
+ */
+
+static void busyWait(int micros)
+{
+    auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(micros);
+    while (std::chrono::steady_clock::now() < end)
+    {
+    }
+}
+
+static void runBench(const char *name, int maxFunctors, int functors, int functorMicros)
+{
+    EventLoopThread thread;
+    EventLoop *loop = thread.startLoop();
+    InetAddress addr(18650, "127.0.0.1");
+    std::unique_ptr<TcpServer> echo;
+    std::promise<void> started;
+    loop->runInLoop([&]() {
+        echo.reset(new TcpServer(loop, addr, "FunctorFloodBench"));
+        echo->setRoundBudget(0, maxFunctors);
+        echo->setConnectionCallback([](const TcpConnectionPtr &) {});
+        echo->setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+            conn->send(buf);
+        });
+        echo->start();
+        started.set_value();
+    });
+    started.get_future().wait();
+
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (::connect(fd, addr.getSockAddr(), addr.getSockLen()) < 0)
+    {
+        ::perror("connect");
+        ::exit(1);
+    }
+    ::usleep(50 * 1000);
+
+    std::atomic_int done(0);
+    auto floodStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < functors; ++i)
+    {
+        loop->queueInLoop([&done, functorMicros]() {
+            busyWait(functorMicros);
+            ++done;
+        });
+    }
+
+    std::vector<double> rtts;
+    while (done.load() < functors)
+    {
+        char c = 'p';
+        auto start = std::chrono::steady_clock::now();
+        if (::write(fd, &c, 1) != 1 || ::read(fd, &c, 1) != 1)
+        {
+            ::perror("ping");
+            ::exit(1);
+        }
+        rtts.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    double floodMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - floodStart).count();
+    ::close(fd);
+
+    std::promise<void> stopped;
+    loop->runInLoop([&]() {
+        echo.reset();
+        stopped.set_value();
+    });
+    stopped.get_future().wait();
+
+    std::sort(rtts.begin(), rtts.end());
+    printf("%-10s %8zu %10.0f %10.0f %10.0f %12.1f\n", name, rtts.size(),
+           rtts[rtts.size() / 2], rtts[rtts.size() * 99 / 100], rtts.back(), floodMs);
+}
+
+int main(int argc, char *argv[])
+{
+    Logger::setLogLevel(Logger::ERROR);
+
+    int functors = argc > 1 ? ::atoi(argv[1]) : 50000;
+    int functorMicros = argc > 2 ? ::atoi(argv[2]) : 5;
+    int maxFunctors = argc > 3 ? ::atoi(argv[3]) : 64;
+
+    printf("%d functors of %d us, budget %d functors per round\n", functors, functorMicros, maxFunctors);
+    printf("%-10s %8s %10s %10s %10s %12s\n", "mode", "pings", "p50 us", "p99 us", "max us", "flood ms");
+    runBench("unlimited", 0, functors, functorMicros);
+    runBench("budgeted", maxFunctors, functors, functorMicros);
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "./net/TcpServer.h"
+#include "./log/Logging.h"
+
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * 建立大量连接，每个连接先完成一次请求和响应然后保持空闲，统计服务器每个空闲连接占用的堆内存
+ * 模拟长连接上大部分时间没有数据的 WebSocket 客户端
+ * 客户端和服务器在同一个进程中，客户端只持有 fd ，不占用堆内存
+ *
+ * 用法: idleMemoryBench [连接数]
+ */
+
+// 当前已经分配出去的堆内存字节数
+static size_t heapInUse()
+{
+    struct mallinfo2 info = ::mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+int main(int argc, char *argv[])
+{
+    Logger::setLogLevel(Logger::ERROR);
+
+    int numConns = argc > 1 ? ::atoi(argv[1]) : 10000;
+    // 每个连接在客户端和服务器各占一个 fd
+    struct rlimit limit;
+    ::getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    ::setrlimit(RLIMIT_NOFILE, &limit);
+    if (limit.rlim_cur < static_cast<rlim_t>(numConns) * 2 + 64)
+    {
+        numConns = static_cast<int>(limit.rlim_cur / 2) - 32;
+        printf("fd limit %lu, use %d connections\n", static_cast<unsigned long>(limit.rlim_cur), numConns);
+    }
+
+    const uint16_t port = 18300;
+    EventLoop *serverLoop = nullptr;
+    std::atomic_int established(0);
+    std::mutex mutex;
+    std::condition_variable cond;
+
+    std::thread server([&]() {
+        EventLoop loop;
+        InetAddress addr(port);
+        TcpServer echo(&loop, addr, "IdleMemoryBench");
+        echo.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+            if (conn->connected())
+            {
+                ++established;
+            }
+        });
+        echo.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+            conn->send(buf);
+        });
+        echo.start();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            serverLoop = &loop;
+            cond.notify_one();
+        }
+        loop.loop();
+    });
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&]() { return serverLoop != nullptr; });
+    }
+
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = ::htons(port);
+    addr.sin_addr.s_addr = ::inet_addr("127.0.0.1");
+
+    std::vector<int> fds;
+    fds.reserve(numConns);
+    size_t before = heapInUse();
+    for (int i = 0; i < numConns; ++i)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (::connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0)
+        {
+            ::perror("connect");
+            ::close(fd);
+            break;
+        }
+        fds.push_back(fd);
+    }
+
+    // 每个连接完成一次请求和响应，之后保持空闲
+    char message[512];
+    ::memset(message, 'm', sizeof(message));
+    for (int fd : fds)
+    {
+        ::write(fd, message, sizeof(message));
+    }
+    char reply[512];
+    for (int fd : fds)
+    {
+        size_t received = 0;
+        while (received < sizeof(reply))
+        {
+            ssize_t n = ::read(fd, reply, sizeof(reply) - received);
+            if (n <= 0)
+            {
+                break;
+            }
+            received += n;
+        }
+    }
+    while (established < static_cast<int>(fds.size()))
+    {
+        ::usleep(1000);
+    }
+    size_t after = heapInUse();
+
+    printf("%zu idle connections, heap %.1f MB, %.0f bytes per connection\n",
+           fds.size(), (after - before) / (1024.0 * 1024), static_cast<double>(after - before) / fds.size());
+
+    for (int fd : fds)
+    {
+        ::close(fd);
+    }
+    serverLoop->quit();
+    server.join();
+    return 0;
+}
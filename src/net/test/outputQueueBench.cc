@@ -0,0 +1,124 @@
+#include "./net/Buffer.h"
+#include "./net/OutputQueue.h"
+#include "./log/Logging.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <memory>
+#include <string>
+
+/**
+ * 模拟慢客户端下发送大响应：每一轮入队一个响应(小头部 + 大响应体)，然后只尝试发送一次
+ * 对端读得比写得慢，发送队列会一直积压，统计发送线程消耗的 CPU 时间
+ * Buffer      : 改造之前的实现，头部和响应体都拷贝到一个连续的 Buffer 中，积压时 makeSpace 反复移动和扩容
+ * OutputQueue : 头部拷贝到块中，响应体只增加引用计数，writev 一次发送多个块
+ *
+ * 用法: outputQueueBench [响应体大小] [响应个数]
+ */
+
+static double threadCpuSeconds()
+{
+    timespec ts;
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 对端慢速读取，每次读完稍微停一下
+static void slowReader(int fd, size_t total)
+{
+    char buf[64 * 1024];
+    size_t received = 0;
+    while (received < total)
+    {
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n <= 0)
+        {
+            break;
+        }
+        received += n;
+        ::usleep(20);
+    }
+}
+
+template <typename Sender>
+static double run(Sender sender, size_t bodySize, int responses)
+{
+    int fds[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    ::fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+    std::string header(200, 'h');
+    std::shared_ptr<char> body(new char[bodySize], std::default_delete<char[]>());
+    ::memset(body.get(), 'b', bodySize);
+    size_t total = (header.size() + bodySize) * responses;
+
+    std::thread reader(slowReader, fds[1], total);
+    double start = threadCpuSeconds();
+    sender(fds[0], header, body, bodySize, responses);
+    double cpu = threadCpuSeconds() - start;
+    reader.join();
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return cpu;
+}
+
+static void sendWithBuffer(int fd, const std::string &header, const std::shared_ptr<char> &body,
+                           size_t bodySize, int responses)
+{
+    Buffer output;
+    int savedErrno = 0;
+    for (int i = 0; i < responses; ++i)
+    {
+        output.append(header);
+        output.append(body.get(), bodySize);
+        ssize_t n = output.writeFd(fd, &savedErrno);
+        if (n > 0)
+        {
+            output.retrieve(n);
+        }
+    }
+    while (output.readableBytes() > 0)
+    {
+        ssize_t n = output.writeFd(fd, &savedErrno);
+        if (n > 0)
+        {
+            output.retrieve(n);
+        }
+    }
+}
+
+static void sendWithQueue(int fd, const std::string &header, const std::shared_ptr<char> &body,
+                          size_t bodySize, int responses)
+{
+    OutputQueue output;
+    int savedErrno = 0;
+    for (int i = 0; i < responses; ++i)
+    {
+        output.append(header.data(), header.size());
+        output.append(body, body.get(), bodySize);
+        output.writeFd(fd, &savedErrno);
+    }
+    while (!output.empty())
+    {
+        output.writeFd(fd, &savedErrno);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Logger::setLogLevel(Logger::ERROR);
+
+    size_t bodySize = argc > 1 ? ::atoi(argv[1]) : 256 * 1024;
+    int responses = argc > 2 ? ::atoi(argv[2]) : 1000;
+
+    printf("body %zu bytes, %d responses\n", bodySize, responses);
+    printf("Buffer      : %8.3f s cpu\n", run(sendWithBuffer, bodySize, responses));
+    printf("OutputQueue : %8.3f s cpu\n", run(sendWithQueue, bodySize, responses));
+    return 0;
+}
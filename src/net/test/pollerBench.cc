@@ -0,0 +1,155 @@
+#include "./net/TcpServer.h"
+#include "./log/Logging.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * 分别使用 epoll 和 io_uring 后端启动单线程 echo 服务器
+ * 客户端线程各自持有若干个连接，每一轮向所有连接发送一条消息再依次读回，统计每秒 echo 的消息数
+ *
+ * 用法: pollerBench [客户端线程数] [每个线程的连接数] [消息大小] [测试秒数]
+ */
+
+static int connectTo(uint16_t port)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = ::htons(port);
+    addr.sin_addr.s_addr = ::inet_addr("127.0.0.1");
+    if (::connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        ::perror("connect");
+        ::exit(1);
+    }
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return fd;
+}
+
+static bool readFull(int fd, char *buf, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = ::read(fd, buf, len);
+        if (n <= 0)
+        {
+            return false;
+        }
+        buf += n;
+        len -= n;
+    }
+    return true;
+}
+
+static double runBench(EventLoop::Backend backend, uint16_t port,
+                       int numThreads, int connsPerThread, size_t msgSize, int seconds)
+{
+    EventLoop *serverLoop = nullptr;
+    std::mutex mutex;
+    std::condition_variable cond;
+
+    // 服务器在独立的线程中运行单个 loop
+    std::thread server([&]() {
+        EventLoop loop(backend);
+        InetAddress addr(port);
+        TcpServer echo(&loop, addr, "PollerBench");
+        echo.setConnectionCallback([](const TcpConnectionPtr &) {});
+        echo.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+            conn->send(buf);
+        });
+        echo.start();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            serverLoop = &loop;
+            cond.notify_one();
+        }
+        loop.loop();
+    });
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&]() { return serverLoop != nullptr; });
+    }
+
+    std::atomic<int64_t> messages(0);
+    std::atomic_bool stop(false);
+    std::vector<std::thread> clients;
+    for (int i = 0; i < numThreads; ++i)
+    {
+        clients.emplace_back([&]() {
+            std::vector<int> fds;
+            for (int j = 0; j < connsPerThread; ++j)
+            {
+                fds.push_back(connectTo(port));
+            }
+            std::string message(msgSize, 'x');
+            std::vector<char> reply(msgSize);
+            int64_t count = 0;
+            while (!stop)
+            {
+                for (int fd : fds)
+                {
+                    if (::write(fd, message.data(), message.size()) != static_cast<ssize_t>(message.size()))
+                    {
+                        return;
+                    }
+                }
+                for (int fd : fds)
+                {
+                    if (!readFull(fd, reply.data(), reply.size()))
+                    {
+                        return;
+                    }
+                }
+                count += fds.size();
+            }
+            messages += count;
+            for (int fd : fds)
+            {
+                ::close(fd);
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    for (std::thread &t : clients)
+    {
+        t.join();
+    }
+    serverLoop->quit();
+    server.join();
+    return static_cast<double>(messages) / seconds;
+}
+
+int main(int argc, char *argv[])
+{
+    Logger::setLogLevel(Logger::ERROR);
+
+    int numThreads = argc > 1 ? ::atoi(argv[1]) : 4;
+    int connsPerThread = argc > 2 ? ::atoi(argv[2]) : 25;
+    size_t msgSize = argc > 3 ? ::atoi(argv[3]) : 64;
+    int seconds = argc > 4 ? ::atoi(argv[4]) : 5;
+
+    printf("clients %d x %d connections, message %zu bytes, %d seconds\n",
+           numThreads, connsPerThread, msgSize, seconds);
+    printf("epoll    : %12.0f msg/s\n",
+           runBench(EventLoop::kEpoll, 18090, numThreads, connsPerThread, msgSize, seconds));
+    printf("io_uring : %12.0f msg/s\n",
+           runBench(EventLoop::kIoUring, 18091, numThreads, connsPerThread, msgSize, seconds));
+    return 0;
+}
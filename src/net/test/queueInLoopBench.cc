@@ -0,0 +1,185 @@
+#include "./net/EventLoop.h"
+#include "./net/EventLoopThread.h"
+#include "./log/Logging.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+
+/**
+ * EventLoop::queueInLoop 跨线程投递的微基准测试
+ * LegacyLoop 是改造之前的实现：std::mutex 保护 std::vector<Functor>，每次跨线程投递都 write eventfd
+ * 分别测试多个生产者线程投递的吞吐量，以及两个 loop 之间来回投递(ping-pong)的往返延迟
+ */
+
+using Functor = std::function<void()> ;
+using Clock = std::chrono::steady_clock ;
+
+class LegacyLoop
+{
+public:
+    LegacyLoop()
+        : quit_(false),
+          wakeupFd_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+          epollfd_(::epoll_create1(EPOLL_CLOEXEC))
+    {
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = wakeupFd_;
+        ::epoll_ctl(epollfd_, EPOLL_CTL_ADD, wakeupFd_, &ev);
+        thread_ = std::thread(&LegacyLoop::loop, this);
+    }
+
+    ~LegacyLoop()
+    {
+        queueInLoop([this]() { quit_ = true; });
+        thread_.join();
+        ::close(wakeupFd_);
+        ::close(epollfd_);
+    }
+
+    void queueInLoop(Functor cb)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            pendingFunctors_.emplace_back(std::move(cb));
+        }
+        uint64_t one = 1;
+        ssize_t n = ::write(wakeupFd_, &one, sizeof(one));
+        (void)n;
+    }
+
+private:
+    void loop()
+    {
+        epoll_event events[16];
+        while (!quit_)
+        {
+            int n = ::epoll_wait(epollfd_, events, 16, 10000);
+            if (n > 0)
+            {
+                uint64_t one = 0;
+                ssize_t r = ::read(wakeupFd_, &one, sizeof(one));
+                (void)r;
+            }
+            std::vector<Functor> functors;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                functors.swap(pendingFunctors_);
+            }
+            for (const Functor &functor : functors)
+            {
+                functor();
+            }
+        }
+    }
+
+    std::atomic_bool quit_;
+    int wakeupFd_;
+    int epollfd_;
+    std::mutex mutex_;
+    std::vector<Functor> pendingFunctors_;
+    std::thread thread_;
+};
+
+// 等待 counter 达到 target
+static void waitFor(const std::atomic<int64_t> &counter, int64_t target)
+{
+    while (counter.load(std::memory_order_acquire) < target)
+    {
+        std::this_thread::yield();
+    }
+}
+
+// numProducers 个线程各自投递 perProducer 个任务，返回每秒处理的任务数
+template <typename Post>
+static double throughput(Post post, int numProducers, int perProducer)
+{
+    std::atomic<int64_t> done(0);
+    Clock::time_point start = Clock::now();
+    std::vector<std::thread> producers;
+    for (int i = 0; i < numProducers; ++i)
+    {
+        producers.emplace_back([&]() {
+            for (int j = 0; j < perProducer; ++j)
+            {
+                post([&done]() { done.fetch_add(1, std::memory_order_release); });
+            }
+        });
+    }
+    for (std::thread &t : producers)
+    {
+        t.join();
+    }
+    waitFor(done, static_cast<int64_t>(numProducers) * perProducer);
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return numProducers * perProducer / seconds;
+}
+
+// 两个 loop 互相投递 rounds 次，返回平均往返时间(微秒)
+template <typename Loop>
+static double pingPong(Loop *a, Loop *b, int rounds)
+{
+    std::atomic<int64_t> done(0);
+    std::function<void(int)> ping;
+    ping = [&](int left) {
+        if (left == 0)
+        {
+            done = 1;
+            return;
+        }
+        b->queueInLoop([&, left]() {
+            a->queueInLoop([&, left]() { ping(left - 1); });
+        });
+    };
+
+    Clock::time_point start = Clock::now();
+    a->queueInLoop([&]() { ping(rounds); });
+    waitFor(done, 1);
+    double micros = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    return micros / rounds;
+}
+
+int main()
+{
+    Logger::setLogLevel(Logger::ERROR);
+
+    const int kPerProducer = 200000;
+    const int kRounds = 20000;
+
+    printf("%-12s %-10s %18s\n", "impl", "producers", "tasks/s");
+    for (int producers = 1; producers <= 8; producers *= 2)
+    {
+        {
+            LegacyLoop loop;
+            double rate = throughput([&loop](Functor f) { loop.queueInLoop(std::move(f)); },
+                                     producers, kPerProducer);
+            printf("%-12s %-10d %18.0f\n", "mutex", producers, rate);
+        }
+        {
+            EventLoopThread thread;
+            EventLoop *loop = thread.startLoop();
+            double rate = throughput([loop](Functor f) { loop->queueInLoop(std::move(f)); },
+                                     producers, kPerProducer);
+            printf("%-12s %-10d %18.0f\n", "lock-free", producers, rate);
+        }
+    }
+
+    {
+        LegacyLoop a, b;
+        printf("%-12s ping-pong rtt %.2f us\n", "mutex", pingPong(&a, &b, kRounds));
+    }
+    {
+        EventLoopThread threadA, threadB;
+        EventLoop *a = threadA.startLoop();
+        EventLoop *b = threadB.startLoop();
+        printf("%-12s ping-pong rtt %.2f us\n", "lock-free", pingPong(a, b, kRounds));
+    }
+    return 0;
+}
@@ -0,0 +1,47 @@
+#include "./net/EventLoop.h"
+#include "./net/EventLoopThread.h"
+#include "./log/Logging.h"
+#include <iostream>
+
+EventLoop *g_loop = nullptr ;
+
+void print(const char *msg)
+{
+    std::cout << Timestamp::now().toFormattedString(true) << " " << msg << std::endl ;
+}
+
+void cancel(TimerId timer)
+{
+    g_loop->cancel(timer) ;
+    std::cout << Timestamp::now().toFormattedString(true) << " cancelled" << std::endl ;
+}
+
+int main()
+{
+    EventLoop loop ;
+    g_loop = &loop ;
+
+    print("main") ;
+    loop.runAfter(1, std::bind(print, "once1")) ;
+    loop.runAfter(1.5, std::bind(print, "once1.5")) ;
+    loop.runAfter(2.5, std::bind(print, "once2.5")) ;
+    loop.runAfter(3.5, std::bind(print, "once3.5")) ;
+    TimerId t45 = loop.runAfter(4.5, std::bind(print, "once4.5")) ;
+    loop.runAfter(4.2, std::bind(cancel, t45)) ;
+    loop.runAfter(4.8, std::bind(cancel, t45)) ;
+    loop.runEvery(2, std::bind(print, "every2")) ;
+    TimerId t3 = loop.runEvery(3, std::bind(print, "every3")) ;
+    loop.runAfter(9.001, std::bind(cancel, t3)) ;
+
+    // 其他线程向 loop 添加定时器
+    EventLoopThread loopThread ;
+    EventLoop *subLoop = loopThread.startLoop() ;
+    subLoop->runAfter(2, [&loop]() {
+        loop.runAfter(0.5, std::bind(print, "cross thread")) ;
+    }) ;
+
+    loop.runAfter(10, [&loop]() { loop.quit() ; }) ;
+    loop.loop() ;
+    print("main loop exits") ;
+    return 0 ;
+}
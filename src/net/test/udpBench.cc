@@ -0,0 +1,169 @@
+#include "./net/UdpServer.h"
+#include "./log/Logging.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <future>
+#include <chrono>
+#include <algorithm>
+
+/**
+ * 客户端向 loopback 上的 UdpServer 持续发送数据报，服务器把每个数据报原样回复
+ * 对比服务器一次 recvmmsg 收取 1 个和 64 个数据报、回复时是否开启 GSO ，统计服务器线程处理每个数据报消耗的 CPU 时间
+ * 客户端发得比服务器处理得快时内核接收队列会丢包，丢包数一并打印
+ *
+ * 用法: udpBench [数据报个数] [数据报大小]
+ */
+
+static const int kBurst = 64; // 客户端每次 sendmmsg 发送的数据报个数
+
+static double threadCpuSeconds()
+{
+    timespec ts;
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+struct Result
+{
+    int64_t received;   // 服务器收到的数据报个数
+    int64_t replies;    // 客户端收到的回复个数
+    double cpuNs;       // 服务器线程处理每个收到的数据报的 CPU 时间
+};
+
+static Result runBench(uint16_t port, int batchSize, bool gso, int count, size_t size)
+{
+    std::promise<EventLoop *> started;
+    std::promise<Result> finished;
+    std::promise<void> stop;
+    std::shared_future<void> stopped = stop.get_future().share();
+
+    std::thread server([&]() {
+        EventLoop loop;
+        UdpServer echo(&loop, InetAddress(port), "UdpBench");
+        echo.setBatchSize(batchSize);
+        if (gso)
+        {
+            echo.setGsoSegmentSize(static_cast<uint16_t>(size));
+        }
+        echo.setMessageCallback([](UdpSocket *socket, const Datagram *datagrams, size_t n, Timestamp) {
+            for (size_t i = 0; i < n; ++i)
+            {
+                socket->sendTo(datagrams[i].data, datagrams[i].len, datagrams[i].peer);
+            }
+        });
+        echo.start();
+        double start = threadCpuSeconds();
+        started.set_value(&loop);
+        loop.loop();
+        Result result;
+        result.received = echo.stats().received;
+        result.replies = 0;
+        result.cpuNs = (threadCpuSeconds() - start) * 1e9 / (result.received > 0 ? result.received : 1);
+        finished.set_value(result);
+    });
+    EventLoop *serverLoop = started.get_future().get();
+
+    int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    int rcvbuf = 16 * 1024 * 1024;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    timeval timeout = { 0, 200 * 1000 };
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = ::htons(port);
+    addr.sin_addr.s_addr = ::inet_addr("127.0.0.1");
+    ::connect(fd, (sockaddr *)&addr, sizeof(addr));
+
+    // 回复在另一个线程中收取，直到 200ms 内没有新的回复
+    std::atomic<int64_t> replies(0);
+    std::thread reader([&]() {
+        std::vector<char> buf(kBurst * 2048);
+        std::vector<mmsghdr> msgs(kBurst);
+        std::vector<iovec> vecs(kBurst);
+        for (int i = 0; i < kBurst; ++i)
+        {
+            vecs[i].iov_base = &buf[i * 2048];
+            vecs[i].iov_len = 2048;
+            ::memset(&msgs[i].msg_hdr, 0, sizeof(msghdr));
+            msgs[i].msg_hdr.msg_iov = &vecs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        while (true)
+        {
+            int n = ::recvmmsg(fd, msgs.data(), kBurst, MSG_WAITFORONE, nullptr);
+            if (n <= 0)
+            {
+                if (stopped.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+                {
+                    break;
+                }
+                continue;
+            }
+            replies += n;
+        }
+    });
+
+    std::vector<char> payload(size, 'u');
+    std::vector<mmsghdr> msgs(kBurst);
+    iovec vec = { &payload[0], size };
+    for (int i = 0; i < kBurst; ++i)
+    {
+        ::memset(&msgs[i].msg_hdr, 0, sizeof(msghdr));
+        msgs[i].msg_hdr.msg_iov = &vec;
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    for (int sent = 0; sent < count; )
+    {
+        int n = ::sendmmsg(fd, msgs.data(), std::min(kBurst, count - sent), 0);
+        if (n > 0)
+        {
+            sent += n;
+        }
+    }
+
+    ::usleep(300 * 1000);
+    stop.set_value();
+    reader.join();
+    serverLoop->quit();
+    server.join();
+    ::close(fd);
+
+    Result result = finished.get_future().get();
+    result.replies = replies;
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    Logger::setLogLevel(Logger::ERROR);
+
+    int count = argc > 1 ? ::atoi(argv[1]) : 500000;
+    size_t size = argc > 2 ? ::atoi(argv[2]) : 1200;
+
+    printf("%d datagrams of %zu bytes over loopback\n", count, size);
+    printf("%-22s %10s %10s %14s\n", "server", "received", "replies", "cpu ns/dgram");
+    struct { const char *name; int batchSize; bool gso; } cases[] = {
+        { "recvmmsg x1", 1, false },
+        { "recvmmsg x64", 64, false },
+        { "recvmmsg x64 + GSO", 64, true },
+    };
+    uint16_t port = 18400;
+    for (const auto &c : cases)
+    {
+        Result result = runBench(port++, c.batchSize, c.gso, count, size);
+        printf("%-22s %10lld %10lld %14.0f\n", c.name, static_cast<long long>(result.received),
+               static_cast<long long>(result.replies), result.cpuNs);
+    }
+    return 0;
+}
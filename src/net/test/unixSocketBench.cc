@@ -0,0 +1,90 @@
+#include "./net/TcpServer.h"
+#include "./log/Logging.h"
+
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+#include <future>
+
+/**
+ * 同一台机器上客户端和回显服务器之间 ping-pong ，每次发送一个小请求并等待回复
+ * 分别走 TCP loopback 和 Unix 域 socket ，对比每次往返的延迟和进程在内核态消耗的 CPU 时间
+ *
+ * 用法: unixSocketBench [往返次数] [消息大小]
+ */
+
+static double systemCpuSeconds()
+{
+    rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static void runBench(const char *name, const InetAddress &addr, int rounds, size_t size)
+{
+    std::promise<EventLoop *> started;
+    std::thread server([&]() {
+        EventLoop loop;
+        TcpServer echo(&loop, addr, "UnixSocketBench");
+        echo.setConnectionCallback([](const TcpConnectionPtr &) {});
+        echo.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+            conn->send(buf);
+        });
+        echo.start();
+        started.set_value(&loop);
+        loop.loop();
+    });
+    EventLoop *serverLoop = started.get_future().get();
+
+    int fd = ::socket(addr.family(), SOCK_STREAM, 0);
+    if (::connect(fd, addr.getSockAddr(), addr.getSockLen()) < 0)
+    {
+        ::perror("connect");
+        ::exit(1);
+    }
+    std::string request(size, 'p');
+    std::string reply(size, 0);
+
+    double cpuStart = systemCpuSeconds();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i)
+    {
+        ::write(fd, request.data(), size);
+        size_t received = 0;
+        while (received < size)
+        {
+            ssize_t n = ::read(fd, &reply[received], size - received);
+            if (n <= 0)
+            {
+                ::perror("read");
+                ::exit(1);
+            }
+            received += n;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double cpu = systemCpuSeconds() - cpuStart;
+    ::close(fd);
+
+    serverLoop->quit();
+    server.join();
+    printf("%-8s %12.2f %16.2f\n", name, seconds * 1e6 / rounds, cpu * 1e6 / rounds);
+}
+
+int main(int argc, char *argv[])
+{
+    Logger::setLogLevel(Logger::ERROR);
+
+    int rounds = argc > 1 ? ::atoi(argv[1]) : 100000;
+    size_t size = argc > 2 ? ::atoi(argv[2]) : 128;
+
+    printf("%d round trips of %zu bytes\n", rounds, size);
+    printf("%-8s %12s %16s\n", "socket", "rtt us", "kernel cpu us");
+    runBench("tcp", InetAddress(18500, "127.0.0.1"), rounds, size);
+    runBench("unix", InetAddress::unixDomain("@unixSocketBench"), rounds, size);
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include "./net/TcpServer.h"
+#include "./log/Logging.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * 服务器向 loopback 上的客户端持续发送固定大小的消息，分别用普通发送和 MSG_ZEROCOPY 发送，统计吞吐量
+ * 消息通过 send(holder, data, len) 发送，每次发送队列清空之后再补充一批
+ * 对比不同消息大小下两种方式的吞吐量，找到零拷贝开始变快的阈值
+ * 注意发往本机的连接内核最终仍然会拷贝，loopback 上零拷贝一般不会更快，只能看出通知的额外开销
+ *
+ * 用法: zeroCopyBench [每一项发送的 MB 数]
+ */
+
+static const int kBatch = 64; // 每次补充的消息数
+
+static int connectTo(uint16_t port)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = ::htons(port);
+    addr.sin_addr.s_addr = ::inet_addr("127.0.0.1");
+    if (::connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        ::perror("connect");
+        ::exit(1);
+    }
+    return fd;
+}
+
+// 返回 MB/s
+static double runBench(uint16_t port, size_t msgSize, size_t zeroCopyThreshold, size_t totalBytes)
+{
+    EventLoop *serverLoop = nullptr;
+    std::mutex mutex;
+    std::condition_variable cond;
+
+    std::thread server([&]() {
+        EventLoop loop;
+        InetAddress addr(port);
+        TcpServer sender(&loop, addr, "ZeroCopyBench");
+        sender.setZeroCopy(zeroCopyThreshold);
+
+        std::shared_ptr<char> payload(new char[msgSize], std::default_delete<char[]>());
+        ::memset(payload.get(), 'z', msgSize);
+        size_t queued = 0;
+        auto refill = [&](const TcpConnectionPtr &conn) {
+            for (int i = 0; i < kBatch && queued < totalBytes; ++i)
+            {
+                conn->send(payload, payload.get(), msgSize);
+                queued += msgSize;
+            }
+        };
+        sender.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+            if (conn->connected())
+            {
+                refill(conn);
+            }
+        });
+        sender.setWriteCompleteCallback(refill);
+        sender.setMessageCallback([](const TcpConnectionPtr &, Buffer *buf, Timestamp) {
+            buf->retrieveAll();
+        });
+        sender.start();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            serverLoop = &loop;
+            cond.notify_one();
+        }
+        loop.loop();
+    });
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&]() { return serverLoop != nullptr; });
+    }
+
+    // 发送的总字节数按消息大小取整
+    size_t expected = (totalBytes + msgSize - 1) / msgSize * msgSize;
+    std::unique_ptr<char[]> buf(new char[256 * 1024]);
+    auto start = std::chrono::steady_clock::now();
+    int fd = connectTo(port);
+    size_t received = 0;
+    while (received < expected)
+    {
+        ssize_t n = ::read(fd, buf.get(), 256 * 1024);
+        if (n <= 0)
+        {
+            break;
+        }
+        received += n;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ::close(fd);
+
+    serverLoop->quit();
+    server.join();
+    return received / seconds / (1024 * 1024);
+}
+
+int main(int argc, char *argv[])
+{
+    Logger::setLogLevel(Logger::ERROR);
+
+    size_t totalBytes = (argc > 1 ? ::atoi(argv[1]) : 512) * 1024UL * 1024;
+    const size_t sizes[] = { 4096, 16384, 32768, 65536, 262144, 1048576 };
+
+    printf("%zu MB per run over loopback\n", totalBytes / (1024 * 1024));
+    printf("%10s %14s %14s\n", "msg bytes", "copy MB/s", "zerocopy MB/s");
+    uint16_t port = 18100;
+    for (size_t size : sizes)
+    {
+        double copy = runBench(port++, size, 0, totalBytes);
+        // 阈值取 1 ，每条消息都走零拷贝
+        double zeroCopy = runBench(port++, size, 1, totalBytes);
+        printf("%10zu %14.0f %14.0f\n", size, copy, zeroCopy);
+    }
+    return 0;
+}